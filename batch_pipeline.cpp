@@ -0,0 +1,343 @@
+#include "batch_pipeline.h"         // заголовочный файл пакетной обработки кадров конвейером
+#include "bounded_queue.h"          // заголовочный файл очереди ограниченной ёмкости между стадиями
+#include "stage_trace.h"            // заголовочный файл трассировки этапов
+#include <iostream>                 // заголовочный файл со стандартной библиотекой ввода/вывода
+#include <chrono>                   // заголовочный файл для измерения занятости стадий
+#include <vector>                   // заголовочный файл списка входных файлов
+#include <cerrno>                   // заголовочный файл для EEXIST
+#include <sys/stat.h>               // заголовочный файл для stat и mkdir
+
+using namespace std;                // используем пространство имён std
+using namespace cv;                 // используем пространство имён cv
+
+
+
+/**************************************************************************/
+/*                       Т И П Ы   Д А Н Н Ы Х                            */
+/**************************************************************************/
+
+// кадр, передаваемый между стадиями конвейера
+struct BatchFrame
+{
+    int index;                      // номер кадра в источнике
+    string name;                    // имя выходного файла (для каталога и шаблона имён)
+    Mat image;                      // входное изображение после декодирования, выходное - после фильтра
+};// BatchFrame
+
+// общие данные стадий конвейера
+struct BatchContext
+{
+    bool video;                     // источник - видеофайл, а не список изображений
+    vector<string> files;           // входные файлы изображений
+    VideoCapture capture;           // входное видео
+    string outputPath;              // выходной каталог или видеофайл
+    double fps;                     // частота кадров выходного видео
+    BoundedQueue<BatchFrame>* decoded; // кадры после декодирования, ждущие фильтра
+    BoundedQueue<BatchFrame>* filtered;// кадры после фильтра, ждущие записи
+    BoundedQueue<Mat>* freeOutputs; // выходные буферы, которые запись вернула для повторного использования
+    double decodeSeconds;           // время, которое стадия декодирования была занята
+    double encodeSeconds;           // время, которое стадия записи была занята
+    int skipped;                    // кадров, которые не удалось декодировать
+    int written;                    // записанных кадров
+    int failed;                     // кадров, которые не удалось записать
+};// BatchContext
+
+
+
+/*------------------------------------------------------------------------*/
+/*                Функции               */
+/*--------------------------------------*/
+
+// секунды, прошедшие с момента start
+static double secondsSince(const chrono::steady_clock::time_point& start)
+{
+    return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+
+
+// имя файла без каталога
+static string baseName(const string& path)
+{
+    size_t slash = path.find_last_of('/');    // последний разделитель каталогов
+    return slash == string::npos ? path : path.substr(slash + 1);
+}
+
+
+
+// каталог пути без имени файла; у имени без каталога это текущий каталог
+static string dirName(const string& path)
+{
+    size_t slash = path.find_last_of('/');    // последний разделитель каталогов
+    if (slash == string::npos)
+        return ".";
+    return slash == 0 ? "/" : path.substr(0, slash);
+}
+
+
+
+// оба пути ведут к одному и тому же файлу или каталогу: сравниваются устройство и индексный узел,
+// поэтому совпадение находится и через разные записи пути, и через символические ссылки
+static bool sameFile(const string& first, const string& second)
+{
+    struct stat firstStat, secondStat;         // сведения о файлах по обоим путям
+    if (stat(first.c_str(), &firstStat) != 0 || stat(second.c_str(), &secondStat) != 0)
+        return false;                          // одного из файлов нет - это точно разные файлы
+    return firstStat.st_dev == secondStat.st_dev && firstStat.st_ino == secondStat.st_ino;
+}
+
+
+
+// стадия декодирования: читает кадры источника по порядку и кладёт их в очередь фильтра
+static void* decodeThread(void* contextPointer)
+{
+    BatchContext* context = static_cast<BatchContext*>(contextPointer);
+    int index = 0;                             // номер очередного кадра
+    SOBEL_TRACE_THREAD_NAME("decode");
+
+    for (size_t i = 0; context->video || i < context->files.size(); i++)
+    {
+        BatchFrame frame;                      // очередной кадр
+        auto start = chrono::steady_clock::now();
+        bool decoded = true;                   // источник ещё не кончился
+        {
+            SOBEL_TRACE_SPAN("decode");
+
+            // кадр видео
+            if (context->video)
+                decoded = context->capture.read(frame.image);
+            // файл изображения: фильтр работает с трёхканальным BGR, поэтому читаем сразу в цвете
+            else
+            {
+                frame.image = imread(context->files[i], IMREAD_COLOR);
+                frame.name = baseName(context->files[i]);
+            }// else
+        }
+        context->decodeSeconds += secondsSince(start);
+
+        // видео кончилось - выходим
+        if (!decoded)
+            break;
+
+        // файл не изображение или повреждён - пропускаем его, а не останавливаем всю партию
+        if (frame.image.empty())
+        {
+            cerr << "Пропущен кадр, который не удалось декодировать: " << (context->video ? string("кадр видео") : context->files[i]) << endl;
+            context->skipped++;
+            continue;
+        }// if
+
+        frame.index = index++;
+
+        // очередь полна - ждём фильтр; так декодирование не уходит вперёд больше чем на ёмкость очереди
+        SOBEL_TRACE_SPAN("decode_queue_wait");
+        if (!context->decoded->push(frame))
+            break;
+    }// for i
+
+    context->decoded->close();                 // новых кадров не будет
+    return NULL;                               // стадия завершена
+}
+
+
+
+// стадия записи: пишет отфильтрованные кадры и возвращает их буферы фильтру
+static void* encodeThread(void* contextPointer)
+{
+    BatchContext* context = static_cast<BatchContext*>(contextPointer);
+    VideoWriter writer;                        // выходное видео, открывается по размеру первого кадра
+    bool writerFailed = false;                 // выходное видео не удалось открыть
+    BatchFrame frame;                          // очередной кадр
+    SOBEL_TRACE_THREAD_NAME("encode");
+
+    while (context->filtered->pop(frame))
+    {
+        SOBEL_TRACE_SPAN("encode");
+        auto start = chrono::steady_clock::now();
+        bool ok = false;                       // кадр записан
+
+        // кодировщик может бросить исключение: кадр считается незаписанным, а очередь разбирается дальше,
+        // иначе декодирование и фильтр навсегда встанут на полной очереди
+        try
+        {
+            if (context->video)
+            {
+                // результат фильтра - одноканальный, поэтому видео пишется в оттенках серого
+                if (!writer.isOpened() && !writerFailed)
+                {
+                    writerFailed = !writer.open(context->outputPath, VideoWriter::fourcc('M', 'J', 'P', 'G'),
+                                                context->fps, frame.image.size(), false);
+                    if (writerFailed)
+                        cerr << "Не удалось открыть выходное видео: " << context->outputPath << endl;
+                }// if
+                if (writer.isOpened())
+                {
+                    writer.write(frame.image);
+                    ok = true;
+                }// if
+            }// if
+            else
+                ok = imwrite(context->outputPath + "/" + frame.name, frame.image);
+        }// try
+        catch (const cv::Exception& error)
+        {
+            cerr << "Не удалось записать кадр " << (context->video ? to_string(frame.index) : frame.name)
+                 << ": " << error.what() << endl;
+            ok = false;
+        }// catch
+        context->encodeSeconds += secondsSince(start);
+
+        if (ok)
+            context->written++;
+        else
+            context->failed++;
+
+        // буфер кадра больше не нужен записи - фильтр заполнит его следующим кадром без выделения памяти
+        context->freeOutputs->push(frame.image);
+        frame.image = Mat();
+    }// while
+
+    writer.release();
+    return NULL;                               // стадия завершена
+}
+
+
+
+// функция пакетной обработки без окон
+int runBatch(const string& inputPath,          // каталог, шаблон имён или видеофайл
+             const string& outputPath,         // выходной каталог или видеофайл
+             SobelProcessor& processor,        // запущенный обработчик кадров
+             int numThreads,                   // количество задач на кадр
+             int queueFrames)                  // ёмкость очередей между стадиями
+{
+    BatchContext context;                      // общие данные стадий
+    struct stat inputStat;                     // сведения о входном пути
+
+    // каталог или шаблон имён - список изображений, иначе - видеофайл
+    bool isDirectory = stat(inputPath.c_str(), &inputStat) == 0 && S_ISDIR(inputStat.st_mode);
+    context.video = !isDirectory && inputPath.find_first_of("*?") == string::npos;
+
+    if (context.video)
+    {
+        // источник не открылся - ни кадра не прочитать
+        if (!context.capture.open(inputPath))
+        {
+            cout << "\033[35m ОШИБКА! Не удалось открыть видео " << inputPath << ". Код ошибки -4\033[0m" << endl;
+            return -4;                         // выходим с ошибкой
+        }// if
+
+        // выходное видео поверх входного уничтожило бы ещё не прочитанные кадры
+        if (sameFile(inputPath, outputPath))
+        {
+            cout << "\033[35m ОШИБКА! Выходной файл " << outputPath << " совпадает со входным. Код ошибки -6\033[0m" << endl;
+            return -6;                         // выходим с ошибкой
+        }// if
+        context.fps = context.capture.get(CAP_PROP_FPS);
+        if (context.fps <= 0)
+            context.fps = defaultVideoFps;
+    }// if
+    else
+    {
+        glob(inputPath, context.files, false);
+
+        // нет ни одного файла
+        if (context.files.empty())
+        {
+            cout << "\033[35m ОШИБКА! Нет входных файлов в " << inputPath << ". Код ошибки -4\033[0m" << endl;
+            return -4;                         // выходим с ошибкой
+        }// if
+
+        // выходной каталог создаётся, если его ещё нет
+        if (mkdir(outputPath.c_str(), 0755) != 0 && errno != EEXIST)
+        {
+            cout << "\033[35m ОШИБКА! Не удалось создать каталог " << outputPath << ". Код ошибки -5\033[0m" << endl;
+            return -5;                         // выходим с ошибкой
+        }// if
+
+        // кадры пишутся под именами источников: в каталоге источника каждый файл молча заменился бы результатом
+        string sourceDirectory = isDirectory ? inputPath : dirName(inputPath);
+        if (sameFile(sourceDirectory, outputPath))
+        {
+            cout << "\033[35m ОШИБКА! Выходной каталог " << outputPath << " совпадает со входным. Код ошибки -6\033[0m" << endl;
+            return -6;                         // выходим с ошибкой
+        }// if
+        context.fps = defaultVideoFps;
+    }// else
+
+    queueFrames = max(1, queueFrames);
+
+    // в обороте queueFrames + 2 выходных буфера: до queueFrames в очереди записи, один пишется и один заполняется
+    BoundedQueue<BatchFrame> decoded(queueFrames);
+    BoundedQueue<BatchFrame> filtered(queueFrames);
+    BoundedQueue<Mat> freeOutputs(queueFrames + 2);
+    for (int i = 0; i < queueFrames + 2; i++)
+        freeOutputs.push(Mat());
+
+    context.outputPath = outputPath;
+    context.decoded = &decoded;
+    context.filtered = &filtered;
+    context.freeOutputs = &freeOutputs;
+    context.decodeSeconds = 0;
+    context.encodeSeconds = 0;
+    context.skipped = 0;
+    context.written = 0;
+    context.failed = 0;
+
+    auto start = chrono::steady_clock::now();  // начало обработки партии
+
+    // стадии декодирования и записи - отдельные потоки, фильтр работает в основном потоке на пуле processor
+    pthread_t decoder, encoder;
+    if (pthread_create(&decoder, NULL, decodeThread, &context) != 0)
+    {
+        cout << "\033[35m ОШИБКА! Поток создан некорректно. Код ошибки -3\033[0m" << endl;
+        return -3;                             // выходим с ошибкой
+    }// if
+    if (pthread_create(&encoder, NULL, encodeThread, &context) != 0)
+    {
+        // декодирование упрётся в закрытую очередь и завершится
+        decoded.close();
+        pthread_join(decoder, NULL);
+        cout << "\033[35m ОШИБКА! Поток создан некорректно. Код ошибки -3\033[0m" << endl;
+        return -3;                             // выходим с ошибкой
+    }// if
+
+    double filterSeconds = 0;                  // время, которое стадия фильтра была занята
+    SOBEL_TRACE_THREAD_NAME("filter");
+    int frames = 0;                            // отфильтрованных кадров
+    BatchFrame frame;                          // очередной кадр
+
+    while (decoded.pop(frame))
+    {
+        Mat output;                            // выходной буфер из оборота
+        freeOutputs.pop(output);
+
+        auto filterStart = chrono::steady_clock::now();
+        processor.process(frame.image, output, numThreads);
+        filterSeconds += secondsSince(filterStart);
+
+        // дальше по конвейеру идёт только результат: входной кадр освобождается
+        frame.image = output;
+        filtered.push(frame);
+        frames++;
+    }// while
+    filtered.close();                          // новых кадров для записи не будет
+
+    pthread_join(decoder, NULL);
+    pthread_join(encoder, NULL);
+    double totalSeconds = secondsSince(start); // длительность обработки партии
+
+    // итоги: при хорошо спрятанном вводе-выводе стадия фильтра занята почти всё время,
+    // очередь перед фильтром почти полна, а очередь перед записью почти пуста
+    cout << "Кадров: \033[38;5;150m" << frames << "\033[0m. Записано: " << context.written
+         << ". Не декодировано: " << context.skipped << ". Не записано: " << context.failed << endl;
+    cout << "Длительность: \033[38;5;205m" << totalSeconds << "\033[0m секунд. Кадров в секунду: \033[38;5;205m"
+         << (totalSeconds > 0 ? frames / totalSeconds : 0) << "\033[0m" << endl;
+    cout << "\tЗанятость стадий, секунд: декодирование " << context.decodeSeconds
+         << ", фильтр " << filterSeconds << ", запись " << context.encodeSeconds << endl;
+    cout << "\tГлубина очереди декодирование -> фильтр: средняя " << decoded.averageDepth()
+         << ", наибольшая " << decoded.maxDepth() << " из " << queueFrames << endl;
+    cout << "\tГлубина очереди фильтр -> запись: средняя " << filtered.averageDepth()
+         << ", наибольшая " << filtered.maxDepth() << " из " << queueFrames << endl;
+
+    return context.failed > 0 ? -5 : 0;       // не все кадры записаны - сообщаем об этом кодом ошибки
+}
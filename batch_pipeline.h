@@ -0,0 +1,34 @@
+#ifndef BATCH_PIPELINE_H
+#define BATCH_PIPELINE_H
+
+#include <string>                   // заголовочный файл строк путей
+#include "sobel_filter.h"           // заголовочный файл многопоточного фильтра Собеля
+
+
+
+/**************************************************************************/
+/*   Г Л О Б А Л Ь Н Ы Е    К О Н С Т А Н Т Ы   И   П Е Р Е М Е Н Н Ы Е   */
+/**************************************************************************/
+
+const int defaultQueueFrames = 4;   // ёмкость очередей между стадиями конвейера, если не задано аргументом queue=N
+const double defaultVideoFps = 25;  // частота кадров выходного видео, если входное её не сообщает
+
+
+
+/**************************************************************************/
+/*                 П Р О Т О Т И П Ы   Ф У Н К Ц И Й                      */
+/**************************************************************************/
+
+// функция пакетной обработки без окон. Источник - каталог, шаблон имён файлов (с * или ?) или видеофайл.
+// Декодирование, фильтр Собеля и запись идут одновременно тремя стадиями, связанными очередями
+// ограниченной ёмкости: пока processor обрабатывает кадр, следующий уже читается, а предыдущий пишется.
+// Кадры изображений пишутся в каталог outputPath под своими именами, кадры видео - в видеофайл outputPath.
+// Выходной каталог не может совпадать с каталогом источника, а выходное видео - со входным.
+// Возвращает 0 или отрицательный код ошибки (-6 - выход совпадает со входом)
+int runBatch(const std::string& inputPath,     // каталог, шаблон имён или видеофайл
+             const std::string& outputPath,    // выходной каталог или видеофайл
+             SobelProcessor& processor,        // запущенный обработчик кадров
+             int numThreads,                   // количество задач на кадр
+             int queueFrames);                 // ёмкость очередей между стадиями
+
+#endif // BATCH_PIPELINE_H
@@ -0,0 +1,124 @@
+#ifndef BOUNDED_QUEUE_H
+#define BOUNDED_QUEUE_H
+
+#include <pthread.h>                // заголовочный файл, предназначенный для работы с потоками в многопоточном программировании
+#include <deque>                    // заголовочный файл очереди элементов
+
+
+
+/**************************************************************************/
+/*                       Т И П Ы   Д А Н Н Ы Х                            */
+/**************************************************************************/
+
+// очередь ограниченной ёмкости между двумя стадиями конвейера. Производитель ждёт, пока в очереди
+// есть место, потребитель - пока в ней есть элементы; так быстрая стадия не уходит вперёд медленной
+// больше чем на capacity кадров. После close производитель больше ничего не кладёт, а потребитель
+// дочитывает оставшееся и получает false
+template <class T>
+class BoundedQueue
+{
+public:
+    explicit BoundedQueue(size_t capacity)
+        : capacity(capacity > 0 ? capacity : 1), closed(false), depthSum(0), depthSamples(0), depthMax(0)
+    {
+        pthread_mutex_init(&mutex, NULL);
+        pthread_cond_init(&notFull, NULL);
+        pthread_cond_init(&notEmpty, NULL);
+    }
+
+    ~BoundedQueue()
+    {
+        pthread_cond_destroy(&notEmpty);
+        pthread_cond_destroy(&notFull);
+        pthread_mutex_destroy(&mutex);
+    }
+
+    // положить элемент, дождавшись места. Возвращает false, если очередь уже закрыта
+    bool push(const T& item)
+    {
+        pthread_mutex_lock(&mutex);
+        while (items.size() >= capacity && !closed)
+            pthread_cond_wait(&notFull, &mutex);
+        if (closed)
+        {
+            pthread_mutex_unlock(&mutex);
+            return false;
+        }// if
+
+        items.push_back(item);
+
+        // глубина очереди сразу после добавления - по ней видно, какая стадия отстаёт
+        depthSum += items.size();
+        depthSamples++;
+        if (items.size() > depthMax)
+            depthMax = items.size();
+
+        pthread_cond_signal(&notEmpty);
+        pthread_mutex_unlock(&mutex);
+        return true;
+    }
+
+    // взять элемент, дождавшись его появления. Возвращает false, если очередь закрыта и пуста
+    bool pop(T& item)
+    {
+        pthread_mutex_lock(&mutex);
+        while (items.empty() && !closed)
+            pthread_cond_wait(&notEmpty, &mutex);
+        if (items.empty())
+        {
+            pthread_mutex_unlock(&mutex);
+            return false;
+        }// if
+
+        item = items.front();
+        items.pop_front();
+        pthread_cond_signal(&notFull);
+        pthread_mutex_unlock(&mutex);
+        return true;
+    }
+
+    // закрыть очередь: новых элементов не будет, ожидающие потоки просыпаются
+    void close()
+    {
+        pthread_mutex_lock(&mutex);
+        closed = true;
+        pthread_cond_broadcast(&notFull);
+        pthread_cond_broadcast(&notEmpty);
+        pthread_mutex_unlock(&mutex);
+        return;                                // возвращаем обещанное функцией значение
+    }
+
+    // средняя глубина очереди после добавления элемента
+    double averageDepth() const
+    {
+        pthread_mutex_lock(&mutex);
+        double average = depthSamples > 0 ? (double)depthSum / depthSamples : 0;
+        pthread_mutex_unlock(&mutex);
+        return average;
+    }
+
+    // наибольшая глубина очереди
+    size_t maxDepth() const
+    {
+        pthread_mutex_lock(&mutex);
+        size_t depth = depthMax;
+        pthread_mutex_unlock(&mutex);
+        return depth;
+    }
+
+private:
+    BoundedQueue(const BoundedQueue&);            // очередь не копируется: она владеет мьютексом
+    BoundedQueue& operator=(const BoundedQueue&);
+
+    mutable pthread_mutex_t mutex;   // мьютекс, защищающий очередь и статистику
+    pthread_cond_t notFull;          // в очереди появилось место
+    pthread_cond_t notEmpty;         // в очереди появился элемент или она закрыта
+    std::deque<T> items;             // элементы очереди
+    size_t capacity;                 // наибольшее количество элементов
+    bool closed;                     // очередь закрыта производителем
+    unsigned long long depthSum;     // сумма глубин после каждого добавления
+    unsigned long long depthSamples; // количество добавлений
+    size_t depthMax;                 // наибольшая глубина
+};// BoundedQueue
+
+#endif // BOUNDED_QUEUE_H
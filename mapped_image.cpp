@@ -0,0 +1,253 @@
+#include "mapped_image.h"           // заголовочный файл изображения, отображённого в память
+#include <cstdio>                   // заголовочный файл для sscanf и snprintf
+#include <cstring>                  // заголовочный файл для memcpy
+#include <cctype>                   // заголовочный файл для isspace и isdigit
+#include <fcntl.h>                  // заголовочный файл для open
+#include <unistd.h>                 // заголовочный файл для close, ftruncate, unlink и sysconf
+#include <sys/mman.h>               // заголовочный файл для mmap, munmap и madvise
+#include <sys/stat.h>               // заголовочный файл для stat и fstat
+
+
+
+/*------------------------------------------------------------------------*/
+/*                Функции               */
+/*--------------------------------------*/
+
+MappedImage::MappedImage()
+    : fd(-1), mapping(NULL), mappingSize(0), dataOffset(0), height(0), width(0), numChannels(0), rgbOrder(false)
+{
+}
+
+
+
+MappedImage::~MappedImage()
+{
+    close();
+}
+
+
+
+// открытие файла только для чтения
+bool MappedImage::open(const std::string& path, const std::string& rawFormat)
+{
+    close();
+
+    fd = ::open(path.c_str(), O_RDONLY);
+    struct stat fileStat;                      // сведения о файле
+    if (fd < 0 || fstat(fd, &fileStat) != 0 || fileStat.st_size == 0)
+    {
+        close();
+        return false;
+    }// if
+
+    mappingSize = (size_t)fileStat.st_size;
+    void* memory = mmap(NULL, mappingSize, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (memory == MAP_FAILED)
+    {
+        mappingSize = 0;
+        close();
+        return false;
+    }// if
+    mapping = static_cast<unsigned char*>(memory);
+
+    // сырые пиксели: размер задан снаружи, порядок каналов - как у OpenCV
+    bool parsed;                               // формат разобран и размер файла ему соответствует
+    if (!rawFormat.empty())
+    {
+        parsed = sscanf(rawFormat.c_str(), "%dx%dx%d", &width, &height, &numChannels) == 3;
+        dataOffset = 0;
+        rgbOrder = false;
+    }// if
+    else
+        parsed = parseHeader(mappingSize);
+
+    parsed = parsed && width > 0 && height > 0 && (numChannels == 1 || numChannels == 3 || numChannels == 4) &&
+             dataOffset + (size_t)height * step() <= mappingSize;
+    if (!parsed)
+    {
+        close();
+        return false;
+    }// if
+
+    // строки читаются подряд сверху вниз - ядро может подгружать страницы заранее
+    madvise(mapping, mappingSize, MADV_SEQUENTIAL);
+    return true;
+}
+
+
+
+// разбор заголовка PGM/PPM
+bool MappedImage::parseHeader(size_t fileSize)
+{
+    if (fileSize < 2 || mapping[0] != 'P' || (mapping[1] != '5' && mapping[1] != '6'))
+        return false;
+
+    numChannels = mapping[1] == '5' ? 1 : 3;
+    rgbOrder = numChannels == 3;
+
+    // три числа заголовка: ширина, высота и наибольшее значение, между ними пробелы и комментарии до конца строки
+    size_t position = 2;                       // текущий байт заголовка
+    long values[3];                            // прочитанные числа
+    for (int i = 0; i < 3; i++)
+    {
+        while (position < fileSize && (isspace(mapping[position]) || mapping[position] == '#'))
+        {
+            if (mapping[position] == '#')
+                while (position < fileSize && mapping[position] != '\n')
+                    position++;
+            else
+                position++;
+        }// while
+
+        if (position >= fileSize || !isdigit(mapping[position]))
+            return false;
+        values[i] = 0;
+        while (position < fileSize && isdigit(mapping[position]) && values[i] < 1000000000)
+            values[i] = values[i] * 10 + (mapping[position++] - '0');
+    }// for i
+
+    // после наибольшего значения ровно один пробельный символ, затем пиксели.
+    // 16-битные файлы (наибольшее значение больше 255) не поддерживаются
+    if (position >= fileSize || !isspace(mapping[position]) || values[2] <= 0 || values[2] > 255)
+        return false;
+
+    width = (int)values[0];
+    height = (int)values[1];
+    dataOffset = position + 1;
+    return true;
+}
+
+
+
+// создание одноканального файла для записи
+bool MappedImage::create(const std::string& path, int rows, int cols)
+{
+    close();
+    if (rows <= 0 || cols <= 0)
+        return false;
+
+    // заголовок PGM, если файл называется *.pgm
+    char header[64] = "";                      // заголовок файла
+    bool pgm = path.size() >= 4 && path.compare(path.size() - 4, 4, ".pgm") == 0;
+    if (pgm)
+        snprintf(header, sizeof(header), "P5\n%d %d\n255\n", cols, rows);
+
+    dataOffset = strlen(header);
+    mappingSize = dataOffset + (size_t)rows * cols;
+
+    // файл сразу получает окончательный размер, а строки записываются в него через отображение
+    fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+    {
+        close();
+        return false;
+    }// if
+
+    // файл уже создан: при ошибке он удаляется, чтобы не оставлять пустой файл полного размера
+    void* memory = MAP_FAILED;                 // отображение файла
+    if (ftruncate(fd, (off_t)mappingSize) == 0)
+        memory = mmap(NULL, mappingSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (memory == MAP_FAILED)
+    {
+        mappingSize = 0;
+        close();
+        unlink(path.c_str());
+        return false;
+    }// if
+    mapping = static_cast<unsigned char*>(memory);
+    memcpy(mapping, header, dataOffset);
+
+    height = rows;
+    width = cols;
+    numChannels = 1;
+    rgbOrder = false;
+    return true;
+}
+
+
+
+// закрытие файла
+void MappedImage::close()
+{
+    if (mapping)
+        munmap(mapping, mappingSize);
+    if (fd >= 0)
+        ::close(fd);
+
+    fd = -1;
+    mapping = NULL;
+    mappingSize = 0;
+    dataOffset = 0;
+    height = width = numChannels = 0;
+    return;                                    // возвращаем обещанное функцией значение
+}
+
+
+
+// тот же ли это файл, что по пути path
+bool MappedImage::sameFile(const std::string& path) const
+{
+    struct stat ownStat, pathStat;             // сведения об открытом файле и о файле по пути
+    if (fd < 0 || fstat(fd, &ownStat) != 0 || stat(path.c_str(), &pathStat) != 0)
+        return false;                          // файла по пути нет - это точно другой файл
+    return ownStat.st_dev == pathStat.st_dev && ownStat.st_ino == pathStat.st_ino;
+}
+
+
+
+int MappedImage::rows() const
+{
+    return height;
+}
+
+
+
+int MappedImage::cols() const
+{
+    return width;
+}
+
+
+
+int MappedImage::channels() const
+{
+    return numChannels;
+}
+
+
+
+bool MappedImage::rgb() const
+{
+    return rgbOrder;
+}
+
+
+
+size_t MappedImage::step() const
+{
+    return (size_t)width * numChannels;
+}
+
+
+
+// начало строки y
+unsigned char* MappedImage::row(int y) const
+{
+    return mapping + dataOffset + (size_t)y * step();
+}
+
+
+
+// выгрузка страниц строк [startRow, endRow] из памяти процесса
+void MappedImage::release(int startRow, int endRow) const
+{
+    static const size_t pageSize = (size_t)sysconf(_SC_PAGESIZE); // размер страницы памяти
+
+    // madvise работает целыми страницами: граничные страницы, общие с соседними строками, тоже выгружаются,
+    // и при следующем обращении просто подгрузятся снова
+    size_t begin = (size_t)(row(startRow) - mapping) / pageSize * pageSize;
+    size_t end = (size_t)(row(endRow) - mapping) + step();
+    if (end > begin)
+        madvise(mapping + begin, end - begin, MADV_DONTNEED);
+    return;                                    // возвращаем обещанное функцией значение
+}
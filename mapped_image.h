@@ -0,0 +1,67 @@
+#ifndef MAPPED_IMAGE_H
+#define MAPPED_IMAGE_H
+
+#include <cstddef>                  // заголовочный файл для типа size_t
+#include <string>                   // заголовочный файл строк путей
+
+
+
+/**************************************************************************/
+/*                       Т И П Ы   Д А Н Н Ы Х                            */
+/**************************************************************************/
+
+// 8-битное изображение в файле, отображённом в память через mmap. Пиксели не читаются в кучу целиком:
+// ядро подгружает страницы файла по мере обращения к строкам, а release отдаёт их обратно, поэтому
+// занятая процессом память зависит от обрабатываемых полос, а не от размера файла.
+// Поддерживаются PGM (P5, оттенки серого), PPM (P6, RGB) и сырые пиксели BGR/BGRA/серого без заголовка
+class MappedImage
+{
+public:
+    MappedImage();
+    ~MappedImage();
+
+    // открытие файла только для чтения. Для сырого файла rawFormat - его размер в виде WxHxC,
+    // для PGM и PPM размер берётся из заголовка, а rawFormat должен быть пустым
+    bool open(const std::string& path, const std::string& rawFormat);
+
+    // создание одноканального файла rows x cols для записи: PGM, если путь оканчивается на .pgm, иначе сырые пиксели
+    bool create(const std::string& path, int rows, int cols);
+
+    // закрытие файла; записанные строки остаются в файле
+    void close();
+
+    // тот же ли это файл, что по пути path (то же устройство и тот же индексный узел), - в том числе
+    // под другим именем или через жёсткую ссылку
+    bool sameFile(const std::string& path) const;
+
+    int rows() const;               // количество строк
+    int cols() const;               // количество столбцов
+    int channels() const;           // каналов на пиксель: 1, 3 или 4
+    bool rgb() const;               // порядок каналов RGB (PPM), а не BGR
+    size_t step() const;            // байт между началами строк
+
+    // начало строки y
+    unsigned char* row(int y) const;
+
+    // строки [startRow, endRow] больше не нужны: их страницы выгружаются из памяти процесса.
+    // Записанные данные не теряются - они уже в страничном кэше файла
+    void release(int startRow, int endRow) const;
+
+private:
+    MappedImage(const MappedImage&);              // отображение не копируется: оно владеет файлом
+    MappedImage& operator=(const MappedImage&);
+
+    // разбор заголовка PGM/PPM; возвращает false, если формат не поддерживается
+    bool parseHeader(size_t fileSize);
+
+    int fd;                          // дескриптор файла
+    unsigned char* mapping;          // начало отображения
+    size_t mappingSize;              // размер отображения - весь файл
+    size_t dataOffset;               // смещение первого пикселя от начала файла
+    int height;                      // количество строк
+    int width;                       // количество столбцов
+    int numChannels;                 // каналов на пиксель
+    bool rgbOrder;                   // порядок каналов RGB
+};// MappedImage
+
+#endif // MAPPED_IMAGE_H
@@ -0,0 +1,185 @@
+#include "row_scheduler.h"          // заголовочный файл планировщика строк с перехватом работы
+#include <algorithm>                // заголовочный файл для min и max
+#include <cstdlib>                  // заголовочный файл для posix_memalign и free
+#include <new>                      // заголовочный файл для размещающего new и std::bad_alloc
+
+
+
+/*------------------------------------------------------------------------*/
+/*                Функции               */
+/*--------------------------------------*/
+
+// упаковка диапазона порций [begin, end) в одно слово очереди
+static inline uint64_t packRange(uint32_t begin, uint32_t end)
+{
+    return ((uint64_t)begin << 32) | end;
+}
+
+
+
+// массив из count очередей, выровненный по строке кэша
+RowScheduler::WorkerQueue* RowScheduler::allocateQueues(int count)
+{
+    void* memory = NULL;                       // память под очереди
+
+    // память кончилась - как и new[], сообщаем об этом исключением
+    if (posix_memalign(&memory, alignof(WorkerQueue), count * sizeof(WorkerQueue)) != 0)
+        throw std::bad_alloc();
+
+    WorkerQueue* queues = static_cast<WorkerQueue*>(memory);
+    for (int i = 0; i < count; i++)
+        new (&queues[i]) WorkerQueue();
+    return queues;
+}
+
+
+
+// освобождение массива из count очередей
+void RowScheduler::freeQueues(WorkerQueue* queues, int count)
+{
+    for (int i = 0; i < count; i++)
+        queues[i].~WorkerQueue();
+    free(queues);
+    return;                                    // возвращаем обещанное функцией значение
+}
+
+
+
+RowScheduler::RowScheduler()
+    : queues(NULL), numQueues(0), numWorkers(0), rows(0), chunkRows(1), stealing(true)
+{
+}
+
+
+
+RowScheduler::~RowScheduler()
+{
+    freeQueues(queues, numQueues);
+}
+
+
+
+// разбиение кадра на порции и раздача их очередям потоков непрерывными диапазонами
+void RowScheduler::reset(int rows, int chunkRows, int numWorkers, bool steal)
+{
+    // очереди выделяются заново только при росте количества потоков
+    if (numWorkers > numQueues)
+    {
+        freeQueues(queues, numQueues);
+        queues = NULL;
+        numQueues = 0;
+        queues = allocateQueues(numWorkers);
+        numQueues = numWorkers;
+    }// if
+
+    this->rows = rows;
+    this->chunkRows = std::max(1, chunkRows);
+    this->numWorkers = numWorkers;
+    this->stealing = steal;
+
+    int numChunks = (rows + this->chunkRows - 1) / this->chunkRows; // количество порций в кадре
+
+    // поток i начинает с порций [i * numChunks / numWorkers, (i + 1) * numChunks / numWorkers) -
+    // то же статическое разбиение, что и раньше, но теперь оно лишь стартовое
+    for (int i = 0; i < numWorkers; i++)
+    {
+        uint32_t begin = (uint32_t)((long long)i * numChunks / numWorkers);
+        uint32_t end = (uint32_t)((long long)(i + 1) * numChunks / numWorkers);
+        queues[i].range.store(packRange(begin, end));
+        queues[i].processed = 0;
+        queues[i].stolen = 0;
+    }// for i
+    return;                                    // возвращаем обещанное функцией значение
+}
+
+
+
+// взять порцию с начала своей очереди: владелец идёт по строкам сверху вниз
+bool RowScheduler::popOwn(int worker, int& chunk)
+{
+    uint64_t range = queues[worker].range.load();
+    for (;;)
+    {
+        uint32_t begin = (uint32_t)(range >> 32);
+        uint32_t end = (uint32_t)range;
+
+        // очередь пуста
+        if (begin >= end)
+            return false;
+
+        // сдвигаем начало; при неудаче range обновится текущим значением и попытка повторится
+        if (queues[worker].range.compare_exchange_weak(range, packRange(begin + 1, end)))
+        {
+            chunk = (int)begin;
+            return true;
+        }// if
+    }// for
+}
+
+
+
+// перехватить порцию с конца очереди victim - дальше всего от того места, где сейчас работает владелец
+bool RowScheduler::steal(int victim, int& chunk)
+{
+    uint64_t range = queues[victim].range.load();
+    for (;;)
+    {
+        uint32_t begin = (uint32_t)(range >> 32);
+        uint32_t end = (uint32_t)range;
+
+        // перехватывать нечего
+        if (begin >= end)
+            return false;
+
+        // сдвигаем конец; при неудаче range обновится текущим значением и попытка повторится
+        if (queues[victim].range.compare_exchange_weak(range, packRange(begin, end - 1)))
+        {
+            chunk = (int)end - 1;
+            return true;
+        }// if
+    }// for
+}
+
+
+
+// следующая порция для потока worker
+bool RowScheduler::next(int worker, int& startRow, int& endRow)
+{
+    int chunk;                                 // номер полученной порции
+    bool found = popOwn(worker, chunk);
+
+    // своя очередь пуста - обходим чужие очереди по кругу, начиная с соседа
+    for (int i = 1; stealing && !found && i < numWorkers; i++)
+    {
+        if (steal((worker + i) % numWorkers, chunk))
+        {
+            found = true;
+            queues[worker].stolen++;
+        }// if
+    }// for i
+
+    // порций не осталось ни в одной очереди: новых не появится, поток может переходить дальше
+    if (!found)
+        return false;
+
+    queues[worker].processed++;
+    startRow = chunk * chunkRows;
+    endRow = std::min(rows, startRow + chunkRows) - 1;
+    return true;
+}
+
+
+
+// количество порций, обработанных потоком worker
+int RowScheduler::chunkCount(int worker) const
+{
+    return queues[worker].processed;
+}
+
+
+
+// количество порций, перехваченных потоком worker
+int RowScheduler::stolenCount(int worker) const
+{
+    return queues[worker].stolen;
+}
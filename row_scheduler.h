@@ -0,0 +1,78 @@
+#ifndef ROW_SCHEDULER_H
+#define ROW_SCHEDULER_H
+
+#include <atomic>                   // заголовочный файл атомарных операций для очередей без блокировок
+#include <cstdint>                  // заголовочный файл для uint64_t
+
+
+
+/**************************************************************************/
+/*                       Т И П Ы   Д А Н Н Ы Х                            */
+/**************************************************************************/
+
+// планировщик строк кадра с перехватом работы. Кадр делится на порции по chunkRows строк,
+// каждый поток сначала получает непрерывный диапазон порций в свою очередь. Владелец берёт
+// порции с начала своей очереди, а освободившиеся потоки перехватывают порции с конца чужих очередей,
+// так что порции вытесненного потока внутри этапа доделывают остальные.
+// Ограничение: у каждого этапа свой планировщик, а между этапами стоит барьер. Перехват не переходит
+// границу этапа, поэтому барьер ждёт последнюю порцию, которую вытесненный поток уже взял, и сам
+// вытесненный поток, даже когда его порций больше нет. Задержка одного ядра всё ещё продлевает каждый этап
+// примерно на квант планировщика ОС; она видна в хвостах p95/p99 замера Sobel_Bench с аргументом busy.
+// Очередь потока - это диапазон номеров порций [begin, end), упакованный в одно 64-битное слово:
+// и владелец, и перехватчик меняют его одной операцией compare_exchange, без мьютексов
+class RowScheduler
+{
+public:
+    RowScheduler();
+    ~RowScheduler();
+
+    // разбиение rows строк на порции по chunkRows строк и раздача их numWorkers очередям.
+    // Без steal каждый поток обрабатывает только свою очередь - чистое статическое разбиение.
+    // Вызывается основным потоком до постановки задач в пул
+    void reset(int rows, int chunkRows, int numWorkers, bool steal);
+
+    // следующая порция для потока worker: сначала из своей очереди, затем перехватом из чужих.
+    // Возвращает false, когда порций не осталось в своей очереди и, если перехват разрешён, в чужих
+    bool next(int worker, int& startRow, int& endRow);
+
+    // количество порций, обработанных потоком worker с последнего reset
+    int chunkCount(int worker) const;
+
+    // сколько из них поток worker перехватил у других потоков
+    int stolenCount(int worker) const;
+
+private:
+    // очередь одного потока, выровненная по строке кэша и занимающая её целиком, чтобы соседние
+    // очереди не делили её между ядрами. new[] в C++11 такое выравнивание не гарантирует,
+    // поэтому массив очередей выделяется через posix_memalign
+    struct alignas(64) WorkerQueue
+    {
+        std::atomic<uint64_t> range; // упакованный диапазон порций: begin в старших 32 битах, end - в младших
+        int processed;               // порций обработано потоком (пишет только сам поток)
+        int stolen;                  // из них перехвачено (пишет только сам поток)
+    };// WorkerQueue
+
+    // массив из count очередей, выровненный по строке кэша
+    static WorkerQueue* allocateQueues(int count);
+
+    // освобождение массива из count очередей
+    static void freeQueues(WorkerQueue* queues, int count);
+
+    // взять порцию с начала своей очереди
+    bool popOwn(int worker, int& chunk);
+
+    // перехватить порцию с конца очереди victim
+    bool steal(int victim, int& chunk);
+
+    RowScheduler(const RowScheduler&);            // планировщик не копируется
+    RowScheduler& operator=(const RowScheduler&);
+
+    WorkerQueue* queues;             // очереди потоков
+    int numQueues;                   // количество выделенных очередей
+    int numWorkers;                  // количество потоков текущего запуска
+    int rows;                        // количество строк кадра
+    int chunkRows;                   // строк в одной порции
+    bool stealing;                   // разрешён ли перехват порций из чужих очередей
+};// RowScheduler
+
+#endif // ROW_SCHEDULER_H
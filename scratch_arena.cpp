@@ -0,0 +1,101 @@
+#include "scratch_arena.h"          // заголовочный файл арены временной памяти
+#include <cstdlib>                  // заголовочный файл для posix_memalign и free
+#include <algorithm>                // заголовочный файл для max
+#include <new>                      // заголовочный файл для std::bad_alloc
+
+
+
+const size_t arenaAlignment = 64;   // выравнивание выделяемых кусков - размер строки кэша
+
+
+
+/*------------------------------------------------------------------------*/
+/*                Функции               */
+/*--------------------------------------*/
+
+// выделение выровненного блока памяти из кучи
+static char* allocateBlock(size_t bytes)
+{
+    void* memory = NULL;                       // новый блок
+
+    // память кончилась - как и operator new, сообщаем об этом исключением
+    if (posix_memalign(&memory, arenaAlignment, bytes) != 0)
+        throw std::bad_alloc();
+    return static_cast<char*>(memory);
+}
+
+
+
+ScratchArena::ScratchArena()
+    : block(NULL), size(0), used(0), requested(0)
+{
+}
+
+
+
+ScratchArena::~ScratchArena()
+{
+    for (size_t i = 0; i < retired.size(); i++)
+        free(retired[i]);
+    free(block);
+}
+
+
+
+// начало новой порции: все выделенные ранее куски больше не используются
+void ScratchArena::reset()
+{
+    // блока не хватило - сливаем все блоки в один размером со всю потребность прошлой порции
+    if (!retired.empty())
+    {
+        for (size_t i = 0; i < retired.size(); i++)
+            free(retired[i]);
+        retired.clear();
+
+        free(block);
+        block = NULL;
+        size = 0;
+        block = allocateBlock(requested);
+        size = requested;
+    }// if
+
+    used = 0;
+    requested = 0;
+    return;                                    // возвращаем обещанное функцией значение
+}
+
+
+
+// кусок памяти размером bytes, выровненный по строке кэша
+void* ScratchArena::allocate(size_t bytes)
+{
+    // размер округляется вверх до выравнивания, чтобы следующий кусок тоже был выровнен
+    bytes = (bytes + arenaAlignment - 1) & ~(arenaAlignment - 1);
+    requested += bytes;
+
+    // не помещается: текущий блок живёт до reset, ведь на него указывают уже выданные куски
+    if (used + bytes > size)
+    {
+        if (block)
+            retired.push_back(block);
+
+        block = NULL;
+        size_t newSize = std::max(bytes, 2 * size);
+        size = 0;
+        block = allocateBlock(newSize);
+        size = newSize;
+        used = 0;
+    }// if
+
+    void* chunk = block + used;                // выделенный кусок
+    used += bytes;
+    return chunk;
+}
+
+
+
+// размер основного блока в байтах
+size_t ScratchArena::capacity() const
+{
+    return size;
+}
@@ -0,0 +1,50 @@
+#ifndef SCRATCH_ARENA_H
+#define SCRATCH_ARENA_H
+
+#include <cstddef>                  // заголовочный файл для типа size_t
+#include <vector>                   // заголовочный файл динамического массива блоков
+
+
+
+/**************************************************************************/
+/*                       Т И П Ы   Д А Н Н Ы Х                            */
+/**************************************************************************/
+
+// арена временной памяти одного потока. Выделение - это сдвиг указателя внутри блока, а reset
+// освобождает всё выделенное разом. Если блока не хватило, новый берётся с запасом, а на следующем
+// reset блоки сливаются в один размером с наибольшую потребность - после первого кадра порции
+// обрабатываются вообще без обращений к куче
+class ScratchArena
+{
+public:
+    ScratchArena();
+    ~ScratchArena();
+
+    // начало новой порции: все выделенные ранее куски больше не используются
+    void reset();
+
+    // кусок памяти размером bytes, выровненный по строке кэша
+    void* allocate(size_t bytes);
+
+    // кусок памяти под count элементов типа T
+    template <class T>
+    T* allocate(size_t count)
+    {
+        return static_cast<T*>(allocate(count * sizeof(T)));
+    }
+
+    // размер основного блока в байтах
+    size_t capacity() const;
+
+private:
+    ScratchArena(const ScratchArena&);            // арена не копируется: она владеет блоками памяти
+    ScratchArena& operator=(const ScratchArena&);
+
+    char* block;                     // основной блок
+    size_t size;                     // размер основного блока
+    size_t used;                     // занято в основном блоке
+    size_t requested;                // всего запрошено с последнего reset - будущий размер блока
+    std::vector<char*> retired;      // блоки, которые перестали вмещать запросы, но ещё могут использоваться до reset
+};// ScratchArena
+
+#endif // SCRATCH_ARENA_H
@@ -0,0 +1,597 @@
+#include <iostream>                 // заголовочный файл со стандартной библиотекой ввода/вывода
+#include <fstream>                  // заголовочный файл для записи CSV и JSON
+#include <opencv2/opencv.hpp>       // заголовок, подтягивающий все функции OpenCV
+#include <chrono>                   // заголовочный файл для измерения времени прогонов
+#include <cstring>                  // заголовочный файл для сравнения строк аргументов консоли
+#include <cstdlib>                  // заголовочный файл для atoi - разбора числовых аргументов консоли
+#include <cstdio>                   // заголовочный файл для sscanf и snprintf
+#include <cmath>                    // заголовочный файл для sqrt
+#include <string>                   // заголовочный файл строк
+#include <vector>                   // заголовочный файл динамических массивов конфигураций и замеров
+#include <algorithm>                // заголовочный файл для sort
+#include <atomic>                   // заголовочный файл для флага остановки потока-конкурента
+#include <pthread.h>                // заголовочный файл для потока-конкурента
+#ifdef __linux__
+#include <sched.h>                  // заголовочный файл для cpu_set_t - закрепления конкурента за ядром
+#endif
+#include "sobel_filter.h"           // заголовочный файл многопоточного фильтра Собеля
+
+using namespace std;                // используем пространство имён std
+using namespace cv;                 // используем пространство имён cv
+
+
+
+/**************************************************************************/
+/*   Г Л О Б А Л Ь Н Ы Е    К О Н С Т А Н Т Ы   И   П Е Р Е М Е Н Н Ы Е   */
+/**************************************************************************/
+
+const int defaultWarmupRuns = 3;    // прогонов для разогрева кэшей и пула до замеров
+const int defaultMeasuredRuns = 15; // замеряемых прогонов одной конфигурации
+const int staticChunkRows = 0;      // условный размер порции "static": одна порция на поток, как при статическом разбиении
+const int busyCore = 0;             // ядро, которое занимает поток-конкурент режима busy
+
+atomic<bool> busyStop(false);       // сигнал потоку-конкуренту завершиться
+
+
+
+/**************************************************************************/
+/*                       Т И П Ы   Д А Н Н Ы Х                            */
+/**************************************************************************/
+
+// тестовое изображение: синтетическое заданного размера или загруженное из файла
+struct BenchImage
+{
+    string name;                    // имя в отчёте: WxH для синтетического, путь для файла
+    Mat image;                      // изображение BGR
+};// BenchImage
+
+// результат одной конфигурации
+struct BenchResult
+{
+    string image;                   // имя изображения
+    int width;                      // ширина изображения
+    int height;                     // высота изображения
+    SobelKernel kernel;             // вариант ядра
+    SobelKernelIsa isa;             // набор инструкций слитого ядра, SOBEL_ISA_AUTO - для цепочки OpenCV
+    int chunkRows;                  // строк в порции, staticChunkRows - статическое разбиение
+    int threads;                    // количество потоков
+    double medianSeconds;           // медиана времени прогона
+    double p95Seconds;              // 95-й процентиль времени прогона
+    double p99Seconds;              // 99-й процентиль времени прогона
+    double meanSeconds;             // среднее время прогона
+    double stddevSeconds;           // стандартное отклонение времени прогона
+    double minSeconds;              // наименьшее время прогона
+    double speedup;                 // ускорение относительно наименьшего количества потоков той же конфигурации
+    double efficiency;              // параллельная эффективность: ускорение на добавленный поток
+};// BenchResult
+
+
+
+/**************************************************************************/
+/*                 П Р О Т О Т И П Ы   Ф У Н К Ц И Й                      */
+/**************************************************************************/
+
+// синтетическое изображение BGR: плавные градиенты с детерминированным шумом, одинаковое на всех машинах
+Mat syntheticImage(int width,                  // ширина изображения
+                   int height);                // высота изображения
+
+// разбор списка целых чисел через запятую
+vector<int> parseIntList(const char* text);    // строка вида 1,2,4
+
+// поток-конкурент: крутит пустой цикл на ядре busyCore, пока не будет поднят busyStop
+void* busyLoop(void* unused);                  // не используется
+
+// поток-конкурент: крутит пустой цикл на ядре busyCore, пока не будет поднят busyStop
+void* busyLoop(void* unused)                   // не используется
+{
+	(void)unused;
+	while (!busyStop.load(memory_order_relaxed))
+		;
+	return NULL;                               // конкурент остановлен
+}
+
+
+
+// статистика замеров одной конфигурации
+void summarize(vector<double>& seconds,        // времена прогонов, сортируются на месте
+               BenchResult& result);           // заполняемый результат
+
+// название варианта ядра
+const char* kernelName(SobelKernel kernel);    // вариант ядра
+
+// название набора инструкций в отчёте: у цепочки OpenCV слитого ядра нет
+const char* isaName(SobelKernel kernel,        // вариант ядра
+                    SobelKernelIsa isa);       // набор инструкций слитого ядра
+
+// название способа разбиения
+string chunkName(int chunkRows);               // строк в порции
+
+// поле CSV в кавычках: кавычки внутри удваиваются, поэтому запятые и кавычки в путях не ломают строку
+string csvField(const string& text);           // значение поля
+
+// запись результатов в CSV
+bool writeCsv(const string& path,              // путь до файла
+              const vector<BenchResult>& results, // результаты всех конфигураций
+              bool busy);                      // шёл ли замер рядом с потоком-конкурентом
+
+// запись результатов в JSON
+bool writeJson(const string& path,             // путь до файла
+               const vector<BenchResult>& results, // результаты всех конфигураций
+               SobelKernelIsa isa,             // набор инструкций слитого ядра
+               int warmupRuns,                 // прогонов для разогрева
+               int measuredRuns,               // замеряемых прогонов
+               bool busy);                     // шёл ли замер рядом с потоком-конкурентом
+
+
+
+/**************************************************************/
+/*            О С Н О В Н А Я   П Р О Г Р А М М А             */
+/**************************************************************/
+int main(int argc, char** argv)
+{
+	vector<int> threadCounts;                  // перебираемые количества потоков
+	vector<int> chunkSizes;                    // перебираемые размеры порций
+	vector<SobelKernel> kernels;               // перебираемые варианты ядра
+	vector<SobelKernelIsa> isas;               // перебираемые наборы инструкций слитого ядра
+	vector<BenchImage> images;                 // перебираемые изображения
+	int warmupRuns = defaultWarmupRuns;        // прогонов для разогрева
+	int measuredRuns = defaultMeasuredRuns;    // замеряемых прогонов
+	bool pinThreads = false;                   // закреплять ли рабочие потоки пула за ядрами
+	bool busy = false;                         // занимать ли одно ядро потоком-конкурентом на время замеров
+	string csvPath, jsonPath;                  // куда записать результаты
+
+	// аргументы вида ключ=значение в любом порядке
+	for (int i = 1; i < argc; i++)
+	{
+		if (strncmp(argv[i], "threads=", 8) == 0)
+			threadCounts = parseIntList(argv[i] + 8);
+		else if (strncmp(argv[i], "chunks=", 7) == 0)
+		{
+			// static - одна порция на поток, иначе - размер порции в строках
+			chunkSizes.clear();
+			string list = argv[i] + 7;
+			size_t begin = 0;
+			while (begin <= list.size())
+			{
+				size_t end = list.find(',', begin);
+				if (end == string::npos)
+					end = list.size();
+				string item = list.substr(begin, end - begin);
+				if (item == "static")
+					chunkSizes.push_back(staticChunkRows);
+				else if (!item.empty())
+					chunkSizes.push_back(max(1, atoi(item.c_str())));
+				begin = end + 1;
+			}// while
+		}// else if
+		else if (strncmp(argv[i], "kernels=", 8) == 0)
+		{
+			kernels.clear();
+			if (strstr(argv[i] + 8, "fused"))
+				kernels.push_back(SOBEL_KERNEL_FUSED);
+			if (strstr(argv[i] + 8, "opencv"))
+				kernels.push_back(SOBEL_KERNEL_OPENCV);
+		}// else if
+		else if (strncmp(argv[i], "isa=", 4) == 0)
+		{
+			// наборы инструкций слитого ядра; не поддерживаемые процессором пропускаются ниже
+			isas.clear();
+			if (strstr(argv[i] + 4, "avx2"))
+				isas.push_back(SOBEL_ISA_AVX2);
+			if (strstr(argv[i] + 4, "sse2"))
+				isas.push_back(SOBEL_ISA_SSE2);
+			if (strstr(argv[i] + 4, "scalar"))
+				isas.push_back(SOBEL_ISA_SCALAR);
+		}// else if
+		else if (strncmp(argv[i], "sizes=", 6) == 0)
+		{
+			// синтетические изображения WxH через запятую
+			const char* item = argv[i] + 6;
+			while (item && *item)
+			{
+				int width, height;
+				if (sscanf(item, "%dx%d", &width, &height) == 2 && width > 0 && height > 0)
+				{
+					BenchImage synthetic;
+					synthetic.name = to_string(width) + "x" + to_string(height);
+					synthetic.image = syntheticImage(width, height);
+					images.push_back(synthetic);
+				}// if
+				item = strchr(item, ',');
+				if (item)
+					item++;
+			}// while
+		}// else if
+		else if (strncmp(argv[i], "image=", 6) == 0)
+		{
+			// настоящее изображение: фильтр работает с BGR, поэтому читаем сразу в цвете
+			BenchImage real;
+			real.name = argv[i] + 6;
+			real.image = imread(real.name, IMREAD_COLOR);
+			if (real.image.empty())
+			{
+				cerr << "Не удалось загрузить изображение " << real.name << endl;
+				return -2;                     // выходим с ошибкой
+			}// if
+			images.push_back(real);
+		}// else if
+		else if (strncmp(argv[i], "warmup=", 7) == 0)
+			warmupRuns = max(0, atoi(argv[i] + 7));
+		else if (strncmp(argv[i], "reps=", 5) == 0)
+			measuredRuns = max(1, atoi(argv[i] + 5));
+		else if (strncmp(argv[i], "csv=", 4) == 0)
+			csvPath = argv[i] + 4;
+		else if (strncmp(argv[i], "json=", 5) == 0)
+			jsonPath = argv[i] + 5;
+		else if (strcmp(argv[i], "pin") == 0)
+			pinThreads = true;
+		else if (strcmp(argv[i], "busy") == 0)
+			busy = true;
+		else
+		{
+			cerr << "Используйте: " << argv[0] << " [threads=1,2,4] [sizes=1920x1080,3840x2160] [image=путь]..."
+			     << " [kernels=fused,opencv] [isa=avx2,sse2,scalar] [chunks=static,8,32] [warmup=N] [reps=N] [csv=путь] [json=путь] [pin] [busy]" << endl;
+			return -1;                         // выходим с ошибкой
+		}// else
+	}// for i
+
+	// значения по умолчанию - та же шкала потоков, что и у Sobel_Filter
+	if (threadCounts.empty())
+		threadCounts = parseIntList("1,2,4,8,16,32,64");
+	sort(threadCounts.begin(), threadCounts.end()); // первым замеряется наименьшее количество потоков - база ускорения
+	if (chunkSizes.empty())
+	{
+		chunkSizes.push_back(staticChunkRows);
+		chunkSizes.push_back(defaultChunkRows);
+	}// if
+	if (kernels.empty())
+	{
+		kernels.push_back(SOBEL_KERNEL_FUSED);
+		kernels.push_back(SOBEL_KERNEL_OPENCV);
+	}// if
+	if (images.empty())
+	{
+		const int sizes[3][2] = {{640, 480}, {1920, 1080}, {3840, 2160}};
+		for (int i = 0; i < 3; i++)
+		{
+			BenchImage synthetic;
+			synthetic.name = to_string(sizes[i][0]) + "x" + to_string(sizes[i][1]);
+			synthetic.image = syntheticImage(sizes[i][0], sizes[i][1]);
+			images.push_back(synthetic);
+		}// for i
+	}// if
+
+	// пул создаётся один раз на наибольшее количество потоков, как и в Sobel_Filter
+	SobelProcessor processor;
+	if (processor.start(threadCounts.back(), pinThreads) != 0)
+	{
+		cerr << "Не удалось создать рабочие потоки" << endl;
+		return -3;                             // выходим с ошибкой
+	}// if
+
+	// по умолчанию слитое ядро замеряется лучшим набором инструкций процессора, а наборы, которых
+	// процессор не поддерживает, пропускаются: их замер показал бы время другого набора
+	vector<SobelKernelIsa> supportedIsas;      // перебираемые наборы, доступные процессору
+	for (size_t i = 0; i < isas.size(); i++)
+	{
+		if (isas[i] <= processor.isa())
+			supportedIsas.push_back(isas[i]);
+		else
+			cerr << "Набор инструкций " << sobelIsaName(isas[i]) << " не поддерживается процессором - пропущен" << endl;
+	}// for i
+	if (supportedIsas.empty())
+		supportedIsas.push_back(processor.isa());
+
+	// busy: поток-конкурент весь замер крутится на одном ядре, как чужой процесс на загруженной машине.
+	// Перехват выравнивает порции внутри этапа, но барьер между этапами всё равно ждёт вытесненный поток,
+	// поэтому цену конкурента показывают хвосты p95 и p99, а не медиана. С pin конкурент делит ядро
+	// с задачей 0, без pin ядра распределяет ОС
+	pthread_t competitor;                      // поток-конкурент режима busy
+	if (busy)
+	{
+		if (pthread_create(&competitor, NULL, busyLoop, NULL) != 0)
+		{
+			cerr << "Не удалось создать поток-конкурент" << endl;
+			processor.stop();
+			return -3;                         // выходим с ошибкой
+		}// if
+#ifdef __linux__
+		cpu_set_t cpus;
+		CPU_ZERO(&cpus);
+		CPU_SET(busyCore, &cpus);
+		pthread_setaffinity_np(competitor, sizeof(cpus), &cpus);
+#endif
+		cout << "Поток-конкурент занимает ядро " << busyCore << endl;
+	}// if
+
+	vector<BenchResult> results;               // результаты всех конфигураций
+	vector<double> seconds(measuredRuns);      // времена прогонов одной конфигурации
+	Mat outputImage;                           // выходное изображение, общее для всех прогонов
+
+	printf("%-24s %-7s %-7s %-7s %7s %12s %12s %12s %12s %8s %8s\n",
+	       "image", "kernel", "isa", "chunks", "threads", "median_ms", "p95_ms", "p99_ms", "stddev_ms", "speedup", "effic");
+
+	// перебор конфигураций: изображение, ядро, набор инструкций, разбиение, затем количество потоков - так
+	// ускорение считается по уже замеренному наименьшему количеству потоков той же конфигурации.
+	// Ядра fused и opencv считают разную магнитуду (см. SobelKernel), поэтому их время сравнимо
+	// лишь как время этапа, а не как два способа получить одно и то же изображение
+	for (size_t im = 0; im < images.size(); im++)
+		for (size_t k = 0; k < kernels.size(); k++)
+			// набор инструкций есть только у слитого ядра - цепочка OpenCV замеряется один раз
+			for (size_t is = 0; is < (kernels[k] == SOBEL_KERNEL_FUSED ? supportedIsas.size() : 1); is++)
+				for (size_t c = 0; c < chunkSizes.size(); c++)
+				{
+					double baseSeconds = 0;        // медиана для наименьшего количества потоков
+					int baseThreads = threadCounts[0];
+
+					SobelOptions options;          // настройки конфигурации
+					options.kernel = kernels[k];
+					options.isa = kernels[k] == SOBEL_KERNEL_FUSED ? supportedIsas[is] : SOBEL_ISA_AUTO;
+
+					for (size_t t = 0; t < threadCounts.size(); t++)
+					{
+						const Mat& inputImage = images[im].image;
+						int threads = threadCounts[t];
+
+						// static: порция на поток без перехвата, то есть прежнее статическое разбиение кадра по полосам
+						if (chunkSizes[c] == staticChunkRows)
+						{
+							options.chunkRows = (inputImage.rows + threads - 1) / threads;
+							options.steal = false;
+						}// if
+						else
+						{
+							options.chunkRows = chunkSizes[c];
+							options.steal = true;
+						}// else
+						processor.setOptions(options);
+
+						// разогрев: буферы кадра выделяются, кэши и предсказатель переходов прогреваются
+						for (int run = 0; run < warmupRuns; run++)
+							processor.process(inputImage, outputImage, threads);
+
+						for (int run = 0; run < measuredRuns; run++)
+						{
+							auto start = chrono::steady_clock::now();
+							processor.process(inputImage, outputImage, threads);
+							seconds[run] = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+						}// for run
+
+						BenchResult result;
+						result.image = images[im].name;
+						result.width = inputImage.cols;
+						result.height = inputImage.rows;
+						result.kernel = kernels[k];
+						result.isa = options.isa;
+						result.chunkRows = chunkSizes[c];
+						result.threads = threads;
+						summarize(seconds, result);
+
+						if (threads == baseThreads)
+							baseSeconds = result.medianSeconds;
+						result.speedup = baseSeconds > 0 ? baseSeconds / result.medianSeconds : 0;
+						result.efficiency = result.speedup * baseThreads / threads;
+						results.push_back(result);
+
+						printf("%-24s %-7s %-7s %-7s %7d %12.3f %12.3f %12.3f %12.3f %8.2f %8.2f\n",
+						       result.image.c_str(), kernelName(result.kernel), isaName(result.kernel, result.isa),
+						       chunkName(result.chunkRows).c_str(),
+						       threads, result.medianSeconds * 1e3, result.p95Seconds * 1e3, result.p99Seconds * 1e3,
+						       result.stddevSeconds * 1e3, result.speedup, result.efficiency);
+						fflush(stdout);
+					}// for t
+				}// for c
+
+	if (busy)
+	{
+		busyStop = true;
+		pthread_join(competitor, NULL);
+	}// if
+	processor.stop();
+
+	// машиночитаемые результаты для сравнения между версиями
+	if (!csvPath.empty() && !writeCsv(csvPath, results, busy))
+	{
+		cerr << "Не удалось записать " << csvPath << endl;
+		return -5;                             // выходим с ошибкой
+	}// if
+	if (!jsonPath.empty() && !writeJson(jsonPath, results, processor.isa(), warmupRuns, measuredRuns, busy))
+	{
+		cerr << "Не удалось записать " << jsonPath << endl;
+		return -5;                             // выходим с ошибкой
+	}// if
+
+	return 0;                                  // возвращаем обещанное ранее значение в случае успеха работы программы
+}
+
+
+
+/*------------------------------------------------------------------------*/
+/*                Функции               */
+/*--------------------------------------*/
+
+// синтетическое изображение BGR: плавные градиенты с детерминированным шумом
+Mat syntheticImage(int width,                  // ширина изображения
+                   int height)                 // высота изображения
+{
+	Mat image(height, width, CV_8UC3);         // создаваемое изображение
+	unsigned int state = 12345;                // состояние линейного конгруэнтного генератора - одинаково при каждом запуске
+
+	for (int y = 0; y < height; y++)
+	{
+		uchar* row = image.ptr<uchar>(y);
+		for (int x = 0; x < width; x++)
+		{
+			// градиенты дают края разной силы, шум - нагрузку на нормализацию и гистограмму
+			state = state * 1103515245u + 12345u;
+			int noise = (int)((state >> 16) & 31);
+			row[3 * x + 0] = (uchar)((x * 255 / max(1, width - 1) + noise) & 255);
+			row[3 * x + 1] = (uchar)((y * 255 / max(1, height - 1) + noise) & 255);
+			row[3 * x + 2] = (uchar)((((x / 64) + (y / 64)) & 1) * 192 + noise);
+		}// for x
+	}// for y
+	return image;
+}
+
+
+
+// разбор списка целых чисел через запятую
+vector<int> parseIntList(const char* text)     // строка вида 1,2,4
+{
+	vector<int> values;                        // разобранные числа
+	while (text && *text)
+	{
+		int value = atoi(text);
+		if (value > 0)
+			values.push_back(value);
+		text = strchr(text, ',');
+		if (text)
+			text++;
+	}// while
+	return values;
+}
+
+
+
+// статистика замеров одной конфигурации
+void summarize(vector<double>& seconds,        // времена прогонов, сортируются на месте
+               BenchResult& result)            // заполняемый результат
+{
+	size_t n = seconds.size();                 // количество замеров
+	sort(seconds.begin(), seconds.end());
+
+	// медиана устойчива к единичным выбросам планировщика ОС, а 95-й и 99-й процентили по ближайшему
+	// рангу показывают именно их: кадры, в которых барьер этапа ждал вытесненный поток
+	result.minSeconds = seconds[0];
+	result.medianSeconds = n % 2 ? seconds[n / 2] : (seconds[n / 2 - 1] + seconds[n / 2]) / 2;
+	result.p95Seconds = seconds[min(n - 1, (size_t)ceil(0.95 * n) - 1)];
+	result.p99Seconds = seconds[min(n - 1, (size_t)ceil(0.99 * n) - 1)];
+
+	double sum = 0;                            // сумма замеров
+	for (size_t i = 0; i < n; i++)
+		sum += seconds[i];
+	result.meanSeconds = sum / n;
+
+	// выборочное стандартное отклонение
+	double squares = 0;                        // сумма квадратов отклонений
+	for (size_t i = 0; i < n; i++)
+		squares += (seconds[i] - result.meanSeconds) * (seconds[i] - result.meanSeconds);
+	result.stddevSeconds = n > 1 ? sqrt(squares / (n - 1)) : 0;
+	return;                                    // возвращаем обещанное функцией значение
+}
+
+
+
+// название варианта ядра
+const char* kernelName(SobelKernel kernel)     // вариант ядра
+{
+	return kernel == SOBEL_KERNEL_FUSED ? "fused" : "opencv";
+}
+
+
+
+// название набора инструкций в отчёте: у цепочки OpenCV слитого ядра нет
+const char* isaName(SobelKernel kernel,        // вариант ядра
+                    SobelKernelIsa isa)        // набор инструкций слитого ядра
+{
+	return kernel == SOBEL_KERNEL_FUSED ? sobelIsaName(isa) : "-";
+}
+
+
+
+// название способа разбиения
+string chunkName(int chunkRows)                // строк в порции
+{
+	return chunkRows == staticChunkRows ? string("static") : to_string(chunkRows);
+}
+
+
+
+// поле CSV в кавычках: кавычки внутри удваиваются, поэтому запятые и кавычки в путях не ломают строку
+string csvField(const string& text)           // значение поля
+{
+	string field = "\"";                       // поле в кавычках
+	for (size_t i = 0; i < text.size(); i++)
+	{
+		if (text[i] == '"')
+			field += '"';
+		field += text[i];
+	}// for i
+	return field + "\"";
+}
+
+
+
+// запись результатов в CSV
+bool writeCsv(const string& path,              // путь до файла
+              const vector<BenchResult>& results, // результаты всех конфигураций
+              bool busy)                       // шёл ли замер рядом с потоком-конкурентом
+{
+	ofstream file(path.c_str());
+	if (!file)
+		return false;
+
+	file << "image,width,height,kernel,isa,chunks,threads,busy,median_s,p95_s,p99_s,mean_s,stddev_s,min_s,speedup,efficiency\n";
+	for (size_t i = 0; i < results.size(); i++)
+	{
+		const BenchResult& r = results[i];
+		file << csvField(r.image) << "," << r.width << "," << r.height << "," << kernelName(r.kernel) << ","
+		     << isaName(r.kernel, r.isa) << "," << chunkName(r.chunkRows) << "," << r.threads << "," << (busy ? 1 : 0) << ","
+		     << r.medianSeconds << "," << r.p95Seconds << "," << r.p99Seconds << ","
+		     << r.meanSeconds << "," << r.stddevSeconds << "," << r.minSeconds << "," << r.speedup << ","
+		     << r.efficiency << "\n";
+	}// for i
+	return (bool)file;
+}
+
+
+
+// запись результатов в JSON
+bool writeJson(const string& path,             // путь до файла
+               const vector<BenchResult>& results, // результаты всех конфигураций
+               SobelKernelIsa isa,             // набор инструкций слитого ядра
+               int warmupRuns,                 // прогонов для разогрева
+               int measuredRuns,               // замеряемых прогонов
+               bool busy)                      // шёл ли замер рядом с потоком-конкурентом
+{
+	ofstream file(path.c_str());
+	if (!file)
+		return false;
+
+	// пути к изображениям могут содержать кавычки и обратные косые черты - экранируем их
+	file << "{\n  \"isa\": \"" << sobelIsaName(isa) << "\",\n  \"warmup\": " << warmupRuns
+	     << ",\n  \"reps\": " << measuredRuns << ",\n  \"busy\": " << (busy ? "true" : "false")
+	     << ",\n  \"results\": [\n";
+	for (size_t i = 0; i < results.size(); i++)
+	{
+		const BenchResult& r = results[i];
+		string image;
+		for (size_t j = 0; j < r.image.size(); j++)
+		{
+			unsigned char symbol = (unsigned char)r.image[j];
+
+			// управляющие символы JSON допускает только в виде \uXXXX
+			if (symbol < 0x20)
+			{
+				char escaped[8];
+				snprintf(escaped, sizeof(escaped), "\\u%04x", symbol);
+				image += escaped;
+				continue;
+			}// if
+			if (symbol == '"' || symbol == '\\')
+				image += '\\';
+			image += r.image[j];
+		}// for j
+
+		file << "    {\"image\": \"" << image << "\", \"width\": " << r.width << ", \"height\": " << r.height
+		     << ", \"kernel\": \"" << kernelName(r.kernel) << "\", \"isa\": \"" << isaName(r.kernel, r.isa)
+		     << "\", \"chunks\": \"" << chunkName(r.chunkRows)
+		     << "\", \"threads\": " << r.threads << ", \"median_s\": " << r.medianSeconds
+		     << ", \"p95_s\": " << r.p95Seconds << ", \"p99_s\": " << r.p99Seconds << ", \"mean_s\": " << r.meanSeconds
+		     << ", \"stddev_s\": " << r.stddevSeconds << ", \"min_s\": " << r.minSeconds
+		     << ", \"speedup\": " << r.speedup << ", \"efficiency\": " << r.efficiency << "}"
+		     << (i + 1 < results.size() ? ",\n" : "\n");
+	}// for i
+	file << "  ]\n}\n";
+	return (bool)file;
+}
@@ -0,0 +1,619 @@
+#include "sobel_filter.h"           // заголовочный файл многопоточного фильтра Собеля
+#include "stage_trace.h"            // заголовочный файл трассировки этапов
+#include <cstring>                  // заголовочный файл для memset
+#include <algorithm>                // заголовочный файл для min, max и fill
+#include <cfloat>                   // заголовочный файл для DBL_MAX и DBL_EPSILON
+
+using namespace std;                // используем пространство имён std
+using namespace cv;                 // используем пространство имён cv
+
+
+
+/*------------------------------------------------------------------------*/
+/*                Функции               */
+/*--------------------------------------*/
+
+// ожидание остальных потоков на барьере между этапами; в трассировке это время простоя потока
+static inline void stageBarrierWait(pthread_barrier_t* stageBarrier)
+{
+	SOBEL_TRACE_SPAN("barrier");
+	pthread_barrier_wait(stageBarrier);
+}
+
+
+
+// функция, которая будет использоваться в качестве точки входа для выполнения операции Sobel в отдельном потоке
+void* SobelThread(void* threadData)            // данные, передаваемые для выполнения операции Sobel в потоке. Должны быть void*        
+{
+	// приводим указатель на данные к типу ThreadData
+    ThreadData* data = static_cast<ThreadData*>(threadData);
+
+	FrameBuffers& frame = *data->frame;        // общие буферы кадра - без копирования заголовков Mat
+	ScratchArena& arena = *data->arena;        // временная память задачи
+	BandStats& own = data->stats[data->worker];// частичные результаты этого потока
+	int startRow, endRow;                      // диапазон строк очередной порции
+
+	// обнуляем свои частичные результаты: другие потоки прочтут их только после барьера
+	own.minValue = DBL_MAX;
+	own.maxValue = -DBL_MAX;
+	memset(own.histogram, 0, sizeof(own.histogram));
+
+	// первый этап: поток переводит в YUV порции строк, своих и перехваченных, и кладёт Y в общий канал яркости
+	{
+		SOBEL_TRACE_SPAN("luma");
+		while (data->chunks[STAGE_LUMA].next(data->worker, startRow, endRow))
+		{
+			arena.reset();                     // временные данные прошлой порции больше не нужны
+			lumaWithRange(frame.inputImage, frame.lumaImage, startRow, endRow, arena);
+		}// while
+	}
+
+	// ждём, пока все потоки посчитают свои порции: соседям понадобятся строки-ореолы сверху и снизу
+	stageBarrierWait(data->stageBarrier);
+
+	// второй этап: вызываем выбранный вариант фильтра Собеля для каждой порции, передавая общий канал яркости только для чтения,
+	// и запоминаем минимум и максимум магнитуды по своим порциям
+	{
+		SOBEL_TRACE_SPAN("sobel");
+		while (data->chunks[STAGE_SOBEL].next(data->worker, startRow, endRow))
+		{
+			if (data->options->kernel == SOBEL_KERNEL_FUSED)
+				sobelFusedYUVWithRange(frame.lumaImage, frame.magnitudeImage, startRow, endRow, data->isa);
+			else
+				sobelYUVWithRange(frame.lumaImage, frame.gradientX, frame.gradientY, frame.magnitudeImage, startRow, endRow);
+
+			double minValue, maxValue;         // минимум и максимум магнитуды порции
+			minMaxLoc(frame.magnitudeImage.rowRange(startRow, endRow + 1), &minValue, &maxValue);
+			own.minValue = min(own.minValue, minValue);
+			own.maxValue = max(own.maxValue, maxValue);
+		}// while
+	}
+	stageBarrierWait(data->stageBarrier);
+
+	// свёртка минимума и максимума: после барьера частичные результаты больше не меняются, поэтому каждый
+	// поток без блокировок читает их все сам. Порядок свёртки одинаков у всех потоков и при любом их количестве
+	double minValue = DBL_MAX, maxValue = -DBL_MAX;
+	for (int i = 0; i < data->numWorkers; i++)
+	{
+		minValue = min(minValue, data->stats[i].minValue);
+		maxValue = max(maxValue, data->stats[i].maxValue);
+	}// for i
+
+	// третий этап: нормализация по минимуму и максимуму всего кадра и гистограмма своих порций
+	{
+		SOBEL_TRACE_SPAN("normalize");
+		while (data->chunks[STAGE_NORMALIZE].next(data->worker, startRow, endRow))
+			normalizeWithRange(frame.magnitudeImage, frame.edgesImage, minValue, maxValue, startRow, endRow, own.histogram);
+	}
+	stageBarrierWait(data->stageBarrier);
+
+	// свёртка гистограмм всех потоков в гистограмму кадра и таблица выравнивания по ней
+	long long histogram[256] = {0};            // гистограмма всего кадра
+	uchar lutData[256];                        // таблица выравнивания на стеке потока
+	{
+		SOBEL_TRACE_SPAN("reduce");
+		for (int i = 0; i < data->numWorkers; i++)
+			for (int bin = 0; bin < 256; bin++)
+				histogram[bin] += data->stats[i].histogram[bin];
+		equalizeLut(histogram, lutData);
+	}
+	Mat lut(1, 256, CV_8UC1, lutData);         // заголовок Mat на таблицу, без копирования
+
+	// четвёртый этап: выравнивание гистограммы на месте по общей таблице. Без выравнивания
+	// порции этапа всё равно разбираются, чтобы счётчики порций не зависели от настроек
+	{
+		SOBEL_TRACE_SPAN("equalize");
+		while (data->chunks[STAGE_EQUALIZE].next(data->worker, startRow, endRow))
+			if (data->options->equalize)
+				equalizeWithRange(frame.edgesImage, lut, startRow, endRow);
+	}
+
+	// размытию нужны уже выровненные строки-ореолы соседних порций
+	stageBarrierWait(data->stageBarrier);
+
+	// пятый этап: повышение резкости с записью прямо в строки общего выходного изображения
+	{
+		SOBEL_TRACE_SPAN("unsharp");
+		while (data->chunks[STAGE_UNSHARP].next(data->worker, startRow, endRow))
+		{
+			arena.reset();                     // временные данные прошлой порции больше не нужны
+
+			// без повышения резкости результат - выровненная магнитуда, копируется в строки порции выходного изображения
+			if (data->options->unsharp)
+				unsharpWithRange(frame.edgesImage, frame.outputImage, startRow, endRow, arena);
+			else
+			{
+				Mat outputBand = frame.outputImage.rowRange(startRow, endRow + 1);
+				frame.edgesImage.rowRange(startRow, endRow + 1).copyTo(outputBand);
+			}// else
+		}// while
+	}
+
+	// задача выполнена; сам рабочий поток пула продолжает ждать следующие задачи, поэтому без pthread_exit
+	return NULL;
+}
+
+
+
+// функция, выделяющая общие буферы кадра под входное изображение
+void allocateFrameBuffers(const Mat& inputImage, // входное изображение
+                          SobelKernel kernel,  // вариант ядра: от него зависят тип магнитуды и нужны ли градиенты
+                          FrameBuffers& frame) // заполняемые буферы кадра
+{
+	frame.inputImage = inputImage;             // входное изображение не копируется - только заголовок
+
+	// канал яркости заполняется потоками по порциям на каждом запуске
+	frame.lumaImage.create(inputImage.size(), CV_8UC1);
+
+	// буферы градиентов нужны только цепочке OpenCV: слитое ядро держит градиенты в регистрах
+	if (kernel == SOBEL_KERNEL_OPENCV)
+	{
+		frame.gradientX.create(inputImage.size(), CV_32FC1);
+		frame.gradientY.create(inputImage.size(), CV_32FC1);
+	}// if
+
+	// магнитуда (8 бит у слитого ядра) и нормализованный результат
+	frame.magnitudeImage.create(inputImage.size(), kernel == SOBEL_KERNEL_FUSED ? CV_8UC1 : CV_32FC1);
+	frame.edgesImage.create(inputImage.size(), CV_8UC1);
+	return;                                    // возвращаем обещанное функцией значение
+}
+
+
+
+// функция, вычисляющая канал яркости Y (YUV) входного изображения в указанном диапазоне строк
+void lumaWithRange(const Mat& inputImage,      // входное изображение: оттенки серого, BGR или BGRA
+                   Mat& lumaImage,             // общий канал яркости, в свою полосу которого пишет поток
+                   int startRow,               // начальная строка полосы
+                   int endRow,                 // конечная строка полосы
+                   ScratchArena& arena)        // арена для временной полосы YUV
+{
+	// убеждаемся, что startRow и endRow находятся в пределах изображения
+    startRow = max(0, startRow);
+    endRow = min(inputImage.rows - 1, endRow);
+
+	// потоков больше, чем строк - полоса пустая, но до барьера поток всё равно должен дойти
+	if (startRow > endRow)
+		return;
+
+	// заголовок на свою полосу общего канала яркости. Размер и тип совпадают, поэтому copyTo и extractChannel
+	// не выделяют новую память, а пишут прямо в общий буфер
+    Mat lumaBand = lumaImage.rowRange(startRow, endRow + 1);
+    Mat inputBand = inputImage.rowRange(startRow, endRow + 1);
+
+	// оттенки серого - это уже яркость
+	if (inputImage.channels() == 1)
+	{
+		inputBand.copyTo(lumaBand);
+		return;
+	}// if
+
+	// матрица для копирования полосы изображения в YUV формате - заголовок на память арены потока.
+	// Размер и тип совпадают с результатом cvtColor, поэтому выделений из кучи нет
+	int bandRows = endRow - startRow + 1;
+    Mat yuvBand(bandRows, inputImage.cols, CV_8UC3, arena.allocate(bandRows * inputImage.cols * 3));
+
+	// у BGRA сначала отбрасывается альфа-канал - в ту же полосу арены, затем яркость считается так же, как у BGR
+	if (inputImage.channels() == 4)
+	{
+		Mat bgrBand(bandRows, inputImage.cols, CV_8UC3, arena.allocate(bandRows * inputImage.cols * 3));
+		cvtColor(inputBand, bgrBand, COLOR_BGRA2BGR);
+		inputBand = bgrBand;
+	}// if
+
+	// перевод в формат YUV только своей полосы: в сумме по всем потокам кадр переводится ровно один раз
+    cvtColor(inputBand, yuvBand, COLOR_BGR2YUV);
+
+	// Y-канал (channels[0]) - в свою полосу общего канала яркости
+    extractChannel(yuvBand, lumaBand, 0);
+	return;                                    // возвращаем обещанное функцией значение
+}
+
+
+
+// функция, вычисляющая градиенты Собеля по тайлам в указанном диапазоне строк прямо в заранее выделенные буферы
+void sobelTilesWithRange(const Mat& lumaImage, // общий канал яркости Y
+                         Mat& gradientX,       // полоса горизонтального градиента (CV_32F) размером endRow - startRow + 1 строк
+                         Mat& gradientY,       // полоса вертикального градиента (CV_32F) того же размера
+                         int startRow,         // начальная строка полосы
+                         int endRow)           // конечная строка полосы
+{
+	// высота тайла: сколько строк яркости (1 байт) и двух градиентов (по 4 байта) помещается в sobelTileBytes
+	int tileRows = max(1, sobelTileBytes / max(1, lumaImage.cols * (1 + 2 * (int)sizeof(float))));
+
+	// проход по тайлам полосы
+	for (int tileStart = startRow; tileStart <= endRow; tileStart += tileRows)
+	{
+		int tileEnd = min(endRow, tileStart + tileRows - 1); // последняя строка тайла
+
+		// тайл - заголовок на строки общего канала яркости. Для подматрицы Sobel берёт строки-ореолы
+		// над и под тайлом из родительского изображения, а отражение BORDER_DEFAULT применяет только
+		// на настоящих краях кадра, поэтому результат совпадает с Sobel по всему кадру
+		Mat tile = lumaImage.rowRange(tileStart, tileEnd + 1);
+
+		// заголовки на соответствующие строки полос градиентов. Размер и тип совпадают с результатом,
+		// поэтому Sobel пишет прямо в заранее выделенную память, без выделений на каждую строку
+		Mat tileGradientX = gradientX.rowRange(tileStart - startRow, tileEnd - startRow + 1);
+		Mat tileGradientY = gradientY.rowRange(tileStart - startRow, tileEnd - startRow + 1);
+
+		// применяем фильтр Собеля
+		// CV_32F - тип данных для хранения градиентов, в данном случае - 32-битное числовое представление с плавающей точкой
+		// 1, 0 и 0, 1 - порядок производных по x и y: горизонтальный и вертикальный градиент соответственно
+		// 3 - размер ядра оператора Собеля 3х3
+		// 3 * sensitivityFactor - масштабный коэффициент вместе с коэффициентом чувствительности, так что отдельное умножение не нужно
+		// 0 - смещение оператора. В данном случае смещения нет
+		// BORDER_DEFAULT - отражение пикселей на границах кадра для вычисления градиента на краях изображения
+		Sobel(tile, tileGradientX, CV_32F, 1, 0, 3, 3 * sensitivityFactor, 0, BORDER_DEFAULT);
+		Sobel(tile, tileGradientY, CV_32F, 0, 1, 3, 3 * sensitivityFactor, 0, BORDER_DEFAULT);
+	}// for tileStart
+	return;                                    // возвращаем обещанное функцией значение
+}
+
+
+
+// функция, выполняющая операцию Sobel на изображении в YUV цветовом пространстве в указанном диапазоне строк
+void sobelYUVWithRange(const Mat& lumaImage,   // общий канал яркости Y в формате const Mat, чтобы не поменять
+                       Mat& gradientXImage,    // общий буфер горизонтального градиента размером с кадр
+                       Mat& gradientYImage,    // общий буфер вертикального градиента размером с кадр
+                       Mat& magnitudeImage,    // общий буфер магнитуды градиента (CV_32F), куда будет записан результат потока
+					   int startRow,           // начальная строка, с которой будет производиться операция Sobel
+					   int endRow)             // конечная строка, до которой будет производиться операция Sobel
+{
+    // убеждаемся, что startRow и endRow находятся в пределах изображения
+	// проверяется, чтобы startRow было не меньше 0, и endRow не превышало количество строк в канале яркости
+    startRow = max(0, startRow); 
+    endRow = min(lumaImage.rows - 1, endRow);
+
+	// пустая полоса - делать нечего
+	if (startRow > endRow)
+		return;
+
+	// полосы градиентов потока - заголовки на его строки общих буферов, полосы потоков не пересекаются
+    Mat gradientX = gradientXImage.rowRange(startRow, endRow + 1);
+    Mat gradientY = gradientYImage.rowRange(startRow, endRow + 1);
+
+	// вычисляем градиенты всей полосы по тайлам
+	{
+		SOBEL_TRACE_SPAN("sobel_gradients");
+		sobelTilesWithRange(lumaImage, gradientX, gradientY, startRow, endRow);
+	}
+
+	// заголовок на строки порции общего буфера магнитуды: размер и тип совпадают, поэтому magnitude пишет прямо в него
+    Mat gradientMagnitude = magnitudeImage.rowRange(startRow, endRow + 1);
+
+	// применяет формулу для вычисления общей магнитуды градиента по следующей формуле:
+	// gradientMagnitude = sqrt{(gradientX)^2 + (gradientY)^2}
+	// этот подход позволяет объединить информацию о градиенте по горизонтали и вертикали в одно значение, которое отображает общую силу изменения яркости в каждой точке изображения
+	{
+		SOBEL_TRACE_SPAN("sobel_magnitude");
+		magnitude(gradientX, gradientY, gradientMagnitude);
+	}
+
+	// нормализация выполняется отдельным этапом, когда известны минимум и максимум всего кадра
+	return;                                    // возвращаем обещанное функцией значение
+}
+
+
+
+// функция, выполняющая операцию Sobel слитым векторным ядром в указанном диапазоне строк
+void sobelFusedYUVWithRange(const Mat& lumaImage, // общий канал яркости Y
+                            Mat& magnitudeImage,  // общий буфер магнитуды градиента (CV_8U), куда будет записан результат потока
+                            int startRow,         // начальная строка полосы
+                            int endRow,           // конечная строка полосы
+                            SobelKernelIsa isa)   // набор инструкций слитого ядра
+{
+    // убеждаемся, что startRow и endRow находятся в пределах изображения
+    startRow = max(0, startRow);
+    endRow = min(lumaImage.rows - 1, endRow);
+
+	// пустая полоса - делать нечего
+	if (startRow > endRow)
+		return;
+
+	// Gx, Gy, sqrt(Gx^2 + Gy^2) * fusedMagnitudeScale и округление до 8 бит за один проход по регистрам
+	// прямо в строки порции общего буфера магнитуды: промежуточных матриц CV_32F нет вовсе.
+	// Строки-ореолы над и под полосой ядро читает прямо из общего канала яркости
+	sobelFusedWithRange(lumaImage.ptr(), lumaImage.step, lumaImage.rows, lumaImage.cols,
+	                    startRow, endRow, magnitudeImage.ptr(startRow), magnitudeImage.step, fusedMagnitudeScale, isa);
+	return;                                    // возвращаем обещанное функцией значение
+}
+
+
+
+// функция, нормализующая магнитуду в диапазоне строк по минимуму и максимуму всего кадра
+void normalizeWithRange(const Mat& magnitudeImage, // общий буфер магнитуды градиента
+                        Mat& edgesImage,       // общий 8-битный буфер результата
+                        double minValue,       // минимум магнитуды по всему кадру
+                        double maxValue,       // максимум магнитуды по всему кадру
+                        int startRow,          // начальная строка порции
+                        int endRow,            // конечная строка порции
+                        long long* histogram)  // гистограмма потока, к которой добавляются пиксели порции
+{
+	// те же масштаб и сдвиг, что вычисляет normalize(..., 0, 255, NORM_MINMAX) для всего кадра.
+	// Порция лишь применяет их, поэтому результат не зависит от того, как кадр поделён между потоками
+	double scale = 255.0 * (maxValue - minValue > DBL_EPSILON ? 1.0 / (maxValue - minValue) : 0);
+	double shift = -minValue * scale;
+
+	// преобразование значений магнитуды в формат CV_8U с масштабом и сдвигом прямо в строки порции общего буфера.
+	// Любые значения, которые выходят за диапазон от 0 до 255, будут отсечены, остальные - округлены
+	Mat edgesBand = edgesImage.rowRange(startRow, endRow + 1);
+	magnitudeImage.rowRange(startRow, endRow + 1).convertTo(edgesBand, CV_8U, scale, shift);
+
+	// гистограмма порции добавляется к гистограмме потока
+	for (int y = 0; y < edgesBand.rows; y++)
+	{
+		const uchar* row = edgesBand.ptr(y);   // очередная строка порции
+		for (int x = 0; x < edgesBand.cols; x++)
+			histogram[row[x]]++;
+	}// for y
+	return;                                    // возвращаем обещанное функцией значение
+}
+
+
+
+// функция, строящая таблицу выравнивания гистограммы так же, как equalizeHist для всего кадра
+void equalizeLut(const long long* histogram,   // гистограмма всего кадра из 256 столбцов
+                 uchar* lut)                   // таблица из 256 значений
+{
+	long long total = 0;                       // количество пикселей кадра: в 64 бит, у больших сканов их больше 2^31
+	for (int bin = 0; bin < 256; bin++)
+		total += histogram[bin];
+
+	memset(lut, 0, 256);
+
+	// первый непустой столбец гистограммы
+	int bin = 0;
+	while (bin < 256 && histogram[bin] == 0)
+		bin++;
+
+	// пустой кадр или все пиксели одной яркости: как и equalizeHist, заполняем результат этой яркостью
+	if (bin == 256 || histogram[bin] == total)
+	{
+		memset(lut, bin == 256 ? 0 : bin, 256);
+		return;
+	}// if
+
+	// накопленная гистограмма, растянутая на диапазон от 0 до 255 - те же формулы и тот же порядок
+	// вычислений, что в equalizeHist, поэтому таблица совпадает с таблицей всего кадра
+	float scale = 255.0f / (float)(total - histogram[bin]);
+	long long sum = 0;                         // накопленное количество пикселей
+	for (lut[bin++] = 0; bin < 256; bin++)
+	{
+		sum += histogram[bin];
+		lut[bin] = saturate_cast<uchar>(sum * scale);
+	}// for bin
+	return;                                    // возвращаем обещанное функцией значение
+}
+
+
+
+// функция, улучшающая контраст выравниванием гистограммы в диапазоне строк по общей таблице
+void equalizeWithRange(Mat& edgesImage,        // общий 8-битный буфер, выравнивается на месте
+                       const Mat& lut,         // таблица выравнивания всего кадра
+                       int startRow,           // начальная строка порции
+                       int endRow)             // конечная строка порции
+{
+	// улучшает контраст изображения, применяя гистограммное выравнивание. 
+	// Гистограммное выравнивание изменяет распределение яркости пикселей таким образом, чтобы расширить
+	// диапазон яркости и улучшить контраст изображения. Таблица построена по гистограмме всего кадра,
+	// поэтому на стыках порций нет швов
+	Mat edgesBand = edgesImage.rowRange(startRow, endRow + 1);
+	LUT(edgesBand, lut, edgesBand);
+	return;                                    // возвращаем обещанное функцией значение
+}
+
+
+
+// функция, повышающая резкость в диапазоне строк: 1.5 * изображение - 0.5 * размытое изображение
+void unsharpWithRange(const Mat& equalizedImage, // общий выровненный буфер, строки-ореолы читаются и за пределами порции
+                      Mat& outputImage,        // общее выходное изображение
+                      int startRow,            // начальная строка порции
+                      int endRow,              // конечная строка порции
+                      ScratchArena& arena)     // арена для размытой полосы
+{
+	int bandRows = endRow - startRow + 1;      // количество строк порции
+	int cols = equalizedImage.cols;            // количество столбцов кадра
+	Mat sourceBand = equalizedImage.rowRange(startRow, endRow + 1);
+	Mat outputBand = outputImage.rowRange(startRow, endRow + 1);
+
+	// размытая полоса берётся из арены потока, а не из кучи
+	Mat blurredBand(bandRows, cols, CV_8UC1, arena.allocate((size_t)bandRows * cols));
+
+	// полоса - подматрица общего буфера, поэтому без BORDER_ISOLATED GaussianBlur берёт строки-ореолы
+	// из соседних порций и отражает края только на краях кадра. Размытие каждого пикселя, включая
+	// округление до 8 бит, то же, что у GaussianBlur целого кадра, при любом делении на порции
+	GaussianBlur(sourceBand, blurredBand, Size(0, 0), unsharpSigma);
+
+	// смешивание изображений: выровненное умножается на коэффициент 1.5, размытое - на -0.5 (вычитание),
+	// и результат с насыщением записывается прямо в строки общего выходного изображения
+	addWeighted(sourceBand, 1.5, blurredBand, -0.5, 0, outputBand);
+	return;                                    // возвращаем обещанное функцией значение
+}
+
+
+
+
+
+
+SobelProcessor::SobelProcessor()
+    : sobelIsa(sobelDetectIsa())
+{
+}
+
+
+
+SobelProcessor::~SobelProcessor()
+{
+    stop();                                    // присоединяем потоки до уничтожения их данных
+}
+
+
+
+// создание maxThreads рабочих потоков пула
+int SobelProcessor::start(int maxThreads, bool pinThreads)
+{
+    maxThreads = max(1, maxThreads);
+
+    // данные задач выделяются один раз на наибольшее количество потоков.
+    // Арены не копируются, поэтому массив создаётся целиком и обменивается
+    data.assign(maxThreads, ThreadData());
+    stats.assign(maxThreads, BandStats());
+    vector<ScratchArena>(maxThreads).swap(arenas);
+
+    // потоков в пуле должно быть не меньше, чем задач в кадре: задачи ждут друг друга на барьере
+    return pool.start(maxThreads, pinThreads);
+}
+
+
+
+// остановка рабочих потоков пула
+void SobelProcessor::stop()
+{
+    pool.stop();
+    return;                                    // возвращаем обещанное функцией значение
+}
+
+
+
+// обработка кадра options().numThreads задачами
+void SobelProcessor::process(const Mat& inputImage, Mat& outputImage)
+{
+    process(inputImage, outputImage, frameOptions.numThreads > 0 ? frameOptions.numThreads : maxThreads());
+    return;                                    // возвращаем обещанное функцией значение
+}
+
+
+
+// обработка кадра в буферах вызывающего без копирования
+void SobelProcessor::process(const unsigned char* input, int rows, int cols, int channels, size_t inputStep,
+                             unsigned char* output, size_t outputStep)
+{
+    // заголовки Mat на чужую память: create выходного изображения того же размера и типа её не перевыделяет
+    Mat inputImage(rows, cols, CV_8UC(channels), const_cast<unsigned char*>(input), inputStep);
+    Mat outputImage(rows, cols, CV_8UC1, output, outputStep);
+    process(inputImage, outputImage);
+    return;                                    // возвращаем обещанное функцией значение
+}
+
+
+
+// обработка кадра numThreads задачами
+void SobelProcessor::process(const Mat& inputImage, Mat& outputImage, int numThreads)
+{
+    SOBEL_TRACE_SPAN("frame");                // весь кадр глазами вызывающего: от постановки задач до их завершения
+
+    // поддерживаются 8-битные оттенки серого, BGR и BGRA; пустой кадр обрабатывать нечего
+    CV_Assert(!inputImage.empty() && inputImage.depth() == CV_8U &&
+              (inputImage.channels() == 1 || inputImage.channels() == 3 || inputImage.channels() == 4));
+    CV_Assert(maxThreads() > 0);               // пул должен быть запущен: задачи ждут друг друга на барьере
+    numThreads = min(max(1, numThreads), maxThreads());
+
+    // выходное изображение вызывающего: при том же размере create не перевыделяет память,
+    // и буферы кадра ссылаются на те же данные, в которые задачи пишут на месте
+    outputImage.create(inputImage.size(), CV_8UC1);
+    allocateFrameBuffers(inputImage, frameOptions.kernel, frame);
+    frame.outputImage = outputImage;
+
+    // барьер между этапами: ждут все numThreads задач, после срабатывания барьер готов к следующему этапу
+    pthread_barrier_t stageBarrier;
+    pthread_barrier_init(&stageBarrier, NULL, numThreads);
+
+    // кадр делится на порции по chunkRows строк. Каждая порция достаётся ровно одному потоку, поэтому
+    // разные потоки не пишут в одну и ту же область памяти и мьютексы для данных не нужны
+    for (int stage = 0; stage < STAGE_COUNT; stage++)
+        chunks[stage].reset(inputImage.rows, frameOptions.chunkRows, numThreads, frameOptions.steal);
+
+    // проходим по всем задачам, которые нам надо поставить в пул
+    for (int i = 0; i < numThreads; ++i)
+    {
+        // передача данных в структуру для каждой задачи
+        data[i].frame = &frame;
+        data[i].arena = &arenas[i];
+        data[i].options = &frameOptions;
+        data[i].isa = kernelIsa();
+        data[i].stageBarrier = &stageBarrier;
+        data[i].worker = i;
+        data[i].numWorkers = numThreads;
+        data[i].chunks = chunks;
+        data[i].stats = &stats[0];
+
+        // постановка в очередь пула функции void* SobelThread(void* threadData) с передачей данных
+        pool.submit(SobelThread, &data[i]);
+    }// for i
+
+    // ожидание выполнения всех задач кадра
+    pool.wait();
+    pthread_barrier_destroy(&stageBarrier);   // все задачи выполнены - барьер больше не нужен
+
+    // заголовки кадра вызывающего больше не нужны: иначе они держали бы его память до следующего кадра,
+    // а у сырых буферов и вовсе указывали бы на память, которую вызывающий мог уже освободить
+    frame.inputImage.release();
+    frame.outputImage.release();
+    return;                                    // возвращаем обещанное функцией значение
+}
+
+
+
+// настройки обработки следующих кадров
+void SobelProcessor::setOptions(const SobelOptions& options)
+{
+    frameOptions = options;
+    frameOptions.numThreads = max(0, options.numThreads);
+    frameOptions.chunkRows = max(1, options.chunkRows);
+    return;                                    // возвращаем обещанное функцией значение
+}
+
+
+
+const SobelOptions& SobelProcessor::options() const
+{
+    return frameOptions;
+}
+
+
+
+// лучший набор инструкций слитого ядра, поддерживаемый процессором
+SobelKernelIsa SobelProcessor::isa() const
+{
+    return sobelIsa;
+}
+
+
+
+// набор инструкций, которым слитое ядро работает при текущих настройках: заданный в настройках,
+// но не больше поддерживаемого процессором, чтобы не выполнить недоступную инструкцию
+SobelKernelIsa SobelProcessor::kernelIsa() const
+{
+    if (frameOptions.isa == SOBEL_ISA_AUTO)
+        return sobelIsa;
+    return min(frameOptions.isa, sobelIsa);
+}
+
+
+
+// количество рабочих потоков пула
+int SobelProcessor::maxThreads() const
+{
+    return pool.size();
+}
+
+
+
+// количество порций, обработанных задачей worker на всех этапах последнего кадра
+int SobelProcessor::chunkCount(int worker) const
+{
+    int processed = 0;                         // порций задачи на всех этапах
+    for (int stage = 0; stage < STAGE_COUNT; stage++)
+        processed += chunks[stage].chunkCount(worker);
+    return processed;
+}
+
+
+
+// сколько порций задача worker перехватила у других задач
+int SobelProcessor::stolenCount(int worker) const
+{
+    int stolen = 0;                            // перехваченных порций задачи на всех этапах
+    for (int stage = 0; stage < STAGE_COUNT; stage++)
+        stolen += chunks[stage].stolenCount(worker);
+    return stolen;
+}
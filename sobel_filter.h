@@ -0,0 +1,240 @@
+#ifndef SOBEL_FILTER_H
+#define SOBEL_FILTER_H
+
+#include <opencv2/opencv.hpp>       // заголовок, подтягивающий все функции OpenCV
+#include <pthread.h>                // заголовочный файл, предназначенный для работы с потоками в многопоточном программировании
+#include <vector>                   // заголовочный файл динамического массива данных задач
+#include "sobel_kernels.h"          // заголовочный файл слитого векторного ядра Собеля
+#include "thread_pool.h"            // заголовочный файл пула рабочих потоков
+#include "row_scheduler.h"          // заголовочный файл планировщика строк с перехватом работы
+#include "scratch_arena.h"          // заголовочный файл арены временной памяти потока
+
+
+
+/**************************************************************************/
+/*   Г Л О Б А Л Ь Н Ы Е    К О Н С Т А Н Т Ы   И   П Е Р Е М Е Н Н Ы Е   */
+/**************************************************************************/
+
+const float sensitivityFactor = 1;  // коэффициент чувствительности для масштабирования значения градиентов и увеличения их чувствительности
+const int sobelTileBytes = 256 * 1024; // объём тайла фильтра Собеля (яркость + два градиента), чтобы он помещался в кэш L2
+const int defaultChunkRows = 32;    // строк в одной порции планировщика, если не задано аргументом chunk=N
+const double unsharpSigma = 5;      // сигма гауссова размытия для повышения резкости
+const int unsharpRadius = 15;       // радиус размытия GaussianBlur с Size(0, 0) для 8 бит: cvRound(sigma * 6 + 1) | 1 = 31 отсчёт; высота ореола полос
+
+// масштаб магнитуды слитого ядра: наибольшая магнитуда Собеля 3x3 для 8 бит - 1020 * sqrt(2), поэтому
+// после умножения на 255 / (1020 * sqrt(2)) любая магнитуда укладывается в 8 бит без насыщения.
+// sensitivityFactor и множитель 3 цепочки OpenCV сокращаются при нормализации по минимуму и максимуму кадра
+const float fusedMagnitudeScale = 255.0f / 1442.4978f;
+
+// вариант ядра фильтра Собеля. Слитое ядро хранит магнитуду в 8 битах, округлённой до целого, поэтому
+// после нормализации отличается от цепочки OpenCV (float без округления) не более чем на единицы
+// яркости - см. проверку testKernelScale. По умолчанию используется цепочка OpenCV, как в исходной программе
+enum SobelKernel
+{
+    SOBEL_KERNEL_OPENCV,            // цепочка OpenCV: Sobel x, Sobel y, magnitude, normalize и convertTo через CV_32F
+    SOBEL_KERNEL_FUSED              // слитое ядро: Gx, Gy, магнитуда и 8-бит результат за один проход
+};// SobelKernel
+
+// этапы обработки кадра. Между этапами все потоки встречаются на барьере, поэтому каждый этап
+// видит результат предыдущего целиком, а не только по своим строкам
+enum SobelStage
+{
+    STAGE_LUMA,                     // канал яркости Y
+    STAGE_SOBEL,                    // магнитуда градиента и её минимум и максимум по порциям потока
+    STAGE_NORMALIZE,                // нормализация по минимуму и максимуму всего кадра и гистограмма порций потока
+    STAGE_EQUALIZE,                 // выравнивание гистограммы по таблице, общей для всего кадра
+    STAGE_UNSHARP,                  // повышение резкости со строками-ореолами соседних порций
+    STAGE_COUNT                     // количество этапов
+};// SobelStage
+
+// частичные результаты одного потока, которые сворачиваются между этапами
+struct BandStats
+{
+    double minValue;                // минимум магнитуды по порциям потока
+    double maxValue;                // максимум магнитуды по порциям потока
+    long long histogram[256];       // гистограмма нормализованных порций потока: 64 бит, в больших сканах больше 2^31 пикселей
+};// BandStats
+
+// настройки обработки кадра. Меняются между кадрами без пересоздания пула
+struct SobelOptions
+{
+    int numThreads;                 // задач на кадр; 0 - по количеству рабочих потоков пула
+    SobelKernel kernel;             // вариант ядра фильтра Собеля
+    SobelKernelIsa isa;             // набор инструкций слитого ядра; больше поддерживаемого процессором не берётся
+    int chunkRows;                  // строк в одной порции планировщика
+    bool steal;                     // перехватывать ли порции у отставших потоков; без него разбиение статическое
+    bool equalize;                  // выравнивать ли гистограмму нормализованной магнитуды
+    bool unsharp;                   // повышать ли резкость результата
+
+    SobelOptions()
+        : numThreads(0), kernel(SOBEL_KERNEL_OPENCV), isa(SOBEL_ISA_AUTO), chunkRows(defaultChunkRows), steal(true), equalize(true), unsharp(true)
+    {
+    }
+};// SobelOptions
+
+// общие буферы кадра. Выделяются основным потоком один раз и переиспользуются всеми запусками;
+// потоки получают указатель на структуру и пишут на месте только в строки своих порций
+struct FrameBuffers
+{
+    cv::Mat inputImage;             // входное изображение: заголовок на кадр вызывающего, только на время process
+    cv::Mat lumaImage;              // канал яркости Y
+    cv::Mat gradientX;              // горизонтальный градиент (CV_32F, только для варианта OpenCV)
+    cv::Mat gradientY;              // вертикальный градиент (CV_32F, только для варианта OpenCV)
+    cv::Mat magnitudeImage;         // магнитуда градиента: CV_32F для OpenCV, CV_8U для слитого ядра
+    cv::Mat edgesImage;             // нормализованная, а затем выровненная магнитуда (CV_8U)
+    cv::Mat outputImage;            // выходное изображение - единственный получатель результата всех потоков, только на время process
+};// FrameBuffers
+
+// структура для работы с фильтром Собеля в потоках pthread.h
+struct ThreadData 
+{
+    FrameBuffers* frame;            // общие буферы кадра
+    ScratchArena* arena;            // арена временной памяти задачи для промежуточных данных порций
+    int worker;                     // номер задачи - номер её очереди в планировщиках и её частичных результатов
+    int numWorkers;                 // количество задач в запуске
+    RowScheduler* chunks;           // планировщики порций строк, по одному на каждый этап SobelStage
+    BandStats* stats;               // частичные результаты всех задач запуска
+    const SobelOptions* options;    // настройки обработки кадра
+    SobelKernelIsa isa;             // набор инструкций слитого ядра, выбранный при запуске
+    pthread_barrier_t* stageBarrier;// барьер между этапами
+};// ThreadData
+
+// многопоточный фильтр Собеля над одним кадром. Пул потоков, данные задач, арены и планировщики порций
+// создаются один раз в start и переиспользуются всеми кадрами и всеми количествами потоков;
+// буферы кадра перевыделяются только при смене размера. Результат пишется в выходное изображение вызывающего
+class SobelProcessor
+{
+public:
+    SobelProcessor();
+    ~SobelProcessor();
+
+    // создание maxThreads рабочих потоков пула. Возвращает 0 или код ошибки pthread_create
+    int start(int maxThreads, bool pinThreads);
+
+    // остановка рабочих потоков пула
+    void stop();
+
+    // обработка кадра: входное изображение 8 бит с 1 (оттенки серого), 3 (BGR) или 4 (BGRA) каналами.
+    // Выходное изображение CV_8UC1 размером с входное создаётся при необходимости и заполняется на месте,
+    // поэтому изображение вызывающего нужного размера не перевыделяется. Кадр обрабатывают
+    // options().numThreads задач, а в перегрузке с numThreads - столько задач (от 1 до maxThreads).
+    // На пустой кадр или неподдерживаемый тип бросается cv::Exception; после возврата обработчик
+    // не держит ни входное, ни выходное изображение
+    void process(const cv::Mat& inputImage, cv::Mat& outputImage);
+    void process(const cv::Mat& inputImage, cv::Mat& outputImage, int numThreads);
+
+    // обработка кадра в буферах вызывающего без копирования: шаг - байт между началами строк
+    void process(const unsigned char* input,  // входные пиксели
+                 int rows,                     // количество строк
+                 int cols,                     // количество столбцов
+                 int channels,                 // каналов входного изображения: 1, 3 или 4
+                 size_t inputStep,             // шаг строк входного буфера
+                 unsigned char* output,        // выходные пиксели, один байт на пиксель
+                 size_t outputStep);           // шаг строк выходного буфера
+
+    // настройки обработки следующих кадров
+    void setOptions(const SobelOptions& options);
+    const SobelOptions& options() const;
+
+    // лучший набор инструкций слитого ядра, поддерживаемый процессором
+    SobelKernelIsa isa() const;
+
+    // набор инструкций, которым слитое ядро работает при текущих настройках
+    SobelKernelIsa kernelIsa() const;
+
+    // количество рабочих потоков пула
+    int maxThreads() const;
+
+    // количество порций, обработанных задачей worker на всех этапах последнего кадра
+    int chunkCount(int worker) const;
+
+    // сколько из них задача worker перехватила у других задач
+    int stolenCount(int worker) const;
+
+private:
+    SobelProcessor(const SobelProcessor&);        // обработчик не копируется: он владеет потоками пула
+    SobelProcessor& operator=(const SobelProcessor&);
+
+    ThreadPool pool;                 // пул рабочих потоков
+    std::vector<ThreadData> data;    // данные задач
+    std::vector<BandStats> stats;    // частичные результаты задач для свёртки между этапами
+    std::vector<ScratchArena> arenas;// арены временной памяти задач
+    RowScheduler chunks[STAGE_COUNT];// планировщики порций, по одному на этап
+    FrameBuffers frame;              // общие буферы кадра
+    SobelOptions frameOptions;       // настройки обработки кадра
+    SobelKernelIsa sobelIsa;         // лучший набор инструкций слитого ядра, поддерживаемый процессором
+};// SobelProcessor
+
+
+
+
+
+/**************************************************************************/
+/*                  П Р О Т О Т И П Ы   Ф У Н К Ц И Й                     */
+/**************************************************************************/
+
+// функция, выделяющая общие промежуточные буферы кадра под входное изображение. Выходное изображение
+// выделяет вызывающий: буферы только ссылаются на него
+void allocateFrameBuffers(const cv::Mat& inputImage, // входное изображение
+                          SobelKernel kernel,  // вариант ядра: от него зависят тип магнитуды и нужны ли градиенты
+                          FrameBuffers& frame);// заполняемые буферы кадра
+
+// функция, вычисляющая канал яркости Y (YUV) входного изображения в указанном диапазоне строк
+void lumaWithRange(const cv::Mat& inputImage,  // входное изображение: оттенки серого, BGR или BGRA
+                   cv::Mat& lumaImage,         // общий канал яркости, в свою полосу которого пишет поток
+                   int startRow,               // начальная строка полосы
+                   int endRow,                 // конечная строка полосы
+                   ScratchArena& arena);       // арена для временной полосы YUV
+
+// функция, вычисляющая градиенты Собеля по тайлам в указанном диапазоне строк прямо в заранее выделенные буферы
+void sobelTilesWithRange(const cv::Mat& lumaImage, // общий канал яркости Y
+                         cv::Mat& gradientX,   // полоса горизонтального градиента (CV_32F) размером endRow - startRow + 1 строк
+                         cv::Mat& gradientY,   // полоса вертикального градиента (CV_32F) того же размера
+                         int startRow,         // начальная строка полосы
+                         int endRow);          // конечная строка полосы
+
+// функция, выполняющая операцию Sobel на изображении в YUV цветовом пространстве в указанном диапазоне строк
+void sobelYUVWithRange(const cv::Mat& lumaImage, // общий канал яркости Y в формате const Mat, чтобы не поменять
+                       cv::Mat& gradientX,     // общий буфер горизонтального градиента размером с кадр
+                       cv::Mat& gradientY,     // общий буфер вертикального градиента размером с кадр
+                       cv::Mat& magnitudeImage, // общий буфер магнитуды градиента (CV_32F), куда будет записан результат потока
+					   int startRow,           // начальная строка, с которой будет производиться операция Sobel
+					   int endRow);            // конечная строка, до которой будет производиться операция Sobel
+
+// функция, выполняющая операцию Sobel слитым векторным ядром в указанном диапазоне строк
+void sobelFusedYUVWithRange(const cv::Mat& lumaImage, // общий канал яркости Y
+                            cv::Mat& magnitudeImage, // общий буфер магнитуды градиента (CV_8U), куда будет записан результат потока
+                            int startRow,         // начальная строка полосы
+                            int endRow,           // конечная строка полосы
+                            SobelKernelIsa isa);  // набор инструкций слитого ядра
+
+// функция, нормализующая магнитуду в диапазоне строк по минимуму и максимуму всего кадра
+void normalizeWithRange(const cv::Mat& magnitudeImage, // общий буфер магнитуды градиента
+                        cv::Mat& edgesImage,   // общий 8-битный буфер результата
+                        double minValue,       // минимум магнитуды по всему кадру
+                        double maxValue,       // максимум магнитуды по всему кадру
+                        int startRow,          // начальная строка порции
+                        int endRow,            // конечная строка порции
+                        long long* histogram); // гистограмма потока, к которой добавляются пиксели порции
+
+// функция, строящая таблицу выравнивания гистограммы так же, как equalizeHist для всего кадра
+void equalizeLut(const long long* histogram,   // гистограмма всего кадра из 256 столбцов
+                 uchar* lut);                  // таблица из 256 значений
+
+// функция, улучшающая контраст выравниванием гистограммы в диапазоне строк по общей таблице
+void equalizeWithRange(cv::Mat& edgesImage,    // общий 8-битный буфер, выравнивается на месте
+                       const cv::Mat& lut,     // таблица выравнивания всего кадра
+                       int startRow,           // начальная строка порции
+                       int endRow);            // конечная строка порции
+
+// функция, повышающая резкость в диапазоне строк: 1.5 * изображение - 0.5 * размытое изображение
+void unsharpWithRange(const cv::Mat& equalizedImage, // общий выровненный буфер, строки-ореолы читаются и за пределами порции
+                      cv::Mat& outputImage,    // общее выходное изображение
+                      int startRow,            // начальная строка порции
+                      int endRow,              // конечная строка порции
+                      ScratchArena& arena);    // арена для промежуточных строк размытия
+
+// функция, которая будет использоваться в качестве точки входа для выполнения операции Sobel в отдельном потоке
+void* SobelThread(void* threadData);           // данные, передаваемые для выполнения операции Sobel в потоке
+
+#endif // SOBEL_FILTER_H
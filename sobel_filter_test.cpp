@@ -0,0 +1,608 @@
+#include <iostream>                 // заголовочный файл со стандартной библиотекой ввода/вывода
+#include <opencv2/opencv.hpp>       // заголовок, подтягивающий все функции OpenCV
+#include <cstring>                  // заголовочный файл для memcmp
+#include <string>                   // заголовочный файл строк описаний проверок
+#include <vector>                   // заголовочный файл сырых буферов
+#include <cstdio>                   // заголовочный файл для fopen и remove
+#include <algorithm>                // заголовочный файл для min и max
+#include <cmath>                    // заголовочный файл для sqrtf и lrintf
+#include <cstdlib>                  // заголовочный файл для abs
+#include "sobel_filter.h"           // заголовочный файл многопоточного фильтра Собеля
+#include "mapped_image.h"           // заголовочный файл изображения, отображённого в память
+#include "scratch_arena.h"          // заголовочный файл арены временной памяти для размытия по полосам
+#include "stream_filter.h"          // заголовочный файл потоковой обработки больших изображений
+
+using namespace std;                // используем пространство имён std
+using namespace cv;                 // используем пространство имён cv
+
+
+
+/**************************************************************************/
+/*   Г Л О Б А Л Ь Н Ы Е    К О Н С Т А Н Т Ы   И   П Е Р Е М Е Н Н Ы Е   */
+/**************************************************************************/
+
+const int testMaxThreads = 16;      // наибольшее количество потоков в проверках - больше строк маленьких кадров
+int failures = 0;                   // количество проваленных проверок
+
+// размеры проверяемых кадров (строки, столбцы): крошечные, нечётные, меньше строк, чем потоков, и обычные
+const int testSizes[][2] = {{1, 1}, {1, 9}, {2, 3}, {3, 40}, {7, 13}, {15, 33}, {31, 17}, {64, 129}, {97, 250}};
+const int numTestSizes = sizeof(testSizes) / sizeof(testSizes[0]);
+
+
+
+/**************************************************************************/
+/*                 П Р О Т О Т И П Ы   Ф У Н К Ц И Й                      */
+/**************************************************************************/
+
+// синтетическое 8-битное изображение с channels каналами: градиенты с детерминированным шумом
+Mat testImage(int rows,                        // количество строк
+              int cols,                        // количество столбцов
+              int channels,                    // количество каналов
+              unsigned int seed);              // начальное состояние генератора шума
+
+// учёт результата проверки
+void check(bool ok,                            // проверка пройдена
+           const string& what);                // описание проверки
+
+// совпадают ли два изображения побитово
+bool sameImage(const Mat& a,                   // первое изображение
+               const Mat& b);                  // второе изображение
+
+// векторные варианты слитого ядра против скалярного эталона на целом кадре и на полосах
+void testFusedIsa();
+
+// градиенты по тайлам и полосам против cv::Sobel по всему каналу яркости
+void testSobelTiles();
+
+// повышение резкости по полосам против GaussianBlur и addWeighted по всему кадру
+void testUnsharpBands();
+
+// масштаб магнитуды слитого ядра и его результат против цепочки OpenCV
+void testKernelScale(SobelProcessor& processor);
+
+// результат любого количества потоков и любых порций против одного потока с одной порцией на весь кадр
+void testThreadCounts(SobelProcessor& processor);
+
+// обработчик с набором инструкций из настроек против набора по умолчанию
+void testIsaOption(SobelProcessor& processor);
+
+// оттенки серого и BGRA против равносильного BGR
+void testInputFormats(SobelProcessor& processor);
+
+// обработка сырых буферов вызывающего с произвольным шагом строк
+void testRawBuffers(SobelProcessor& processor);
+
+// пустой кадр отклоняется исключением, и обработчик после этого продолжает работать
+void testEmptyInput(SobelProcessor& processor);
+
+// потоковая обработка файлов PPM, PGM и сырых пикселей против обработки в памяти слитым ядром
+void testStream(SobelProcessor& processor);
+
+
+
+/**************************************************************/
+/*            О С Н О В Н А Я   П Р О Г Р А М М А             */
+/**************************************************************/
+int main()
+{
+	SobelProcessor processor;                  // проверяемый обработчик
+
+	// создание рабочих потоков пула
+	if (processor.start(testMaxThreads, false) != 0)
+	{
+		cout << "Не удалось создать рабочие потоки" << endl;
+		return 1;                              // проверки невозможны
+	}// if
+
+	testFusedIsa();
+	testSobelTiles();
+	testUnsharpBands();
+	testKernelScale(processor);
+	testThreadCounts(processor);
+	testIsaOption(processor);
+	testInputFormats(processor);
+	testRawBuffers(processor);
+	testEmptyInput(processor);
+	testStream(processor);
+	processor.stop();
+
+	if (failures > 0)
+	{
+		cout << "Провалено проверок: " << failures << endl;
+		return 1;                              // код ошибки для CTest
+	}// if
+
+	cout << "Все проверки пройдены" << endl;
+	return 0;                                  // возвращаем обещанное ранее значение в случае успеха работы программы
+}
+
+
+
+/*------------------------------------------------------------------------*/
+/*                Функции               */
+/*--------------------------------------*/
+
+// синтетическое 8-битное изображение с channels каналами
+Mat testImage(int rows,                        // количество строк
+              int cols,                        // количество столбцов
+              int channels,                    // количество каналов
+              unsigned int seed)               // начальное состояние генератора шума
+{
+	Mat image(rows, cols, CV_8UC(channels));   // создаваемое изображение
+
+	for (int y = 0; y < rows; y++)
+	{
+		uchar* row = image.ptr<uchar>(y);
+		for (int x = 0; x < cols * channels; x++)
+		{
+			// шум поверх ступенек даёт и сильные, и слабые края
+			seed = seed * 1103515245u + 12345u;
+			row[x] = (uchar)((((x / channels / 5) + (y / 4)) & 1) * 160 + ((seed >> 16) & 63) + (x % channels) * 7);
+		}// for x
+	}// for y
+	return image;
+}
+
+
+
+// учёт результата проверки
+void check(bool ok,                            // проверка пройдена
+           const string& what)                 // описание проверки
+{
+	if (!ok)
+	{
+		cout << "ПРОВАЛ: " << what << endl;
+		failures++;
+	}// if
+	return;                                    // возвращаем обещанное функцией значение
+}
+
+
+
+// совпадают ли два изображения побитово
+bool sameImage(const Mat& a,                   // первое изображение
+               const Mat& b)                   // второе изображение
+{
+	if (a.size() != b.size() || a.type() != b.type())
+		return false;
+
+	for (int y = 0; y < a.rows; y++)
+		if (memcmp(a.ptr<uchar>(y), b.ptr<uchar>(y), a.cols * a.elemSize()) != 0)
+			return false;
+	return true;
+}
+
+
+
+// векторные варианты слитого ядра против скалярного эталона на целом кадре и на полосах
+void testFusedIsa()
+{
+	SobelKernelIsa best = sobelDetectIsa();    // лучший набор инструкций процессора
+
+	for (int s = 0; s < numTestSizes; s++)
+	{
+		int rows = testSizes[s][0], cols = testSizes[s][1];
+		Mat luma = testImage(rows, cols, 1, 7 + s);
+		Mat reference(rows, cols, CV_8UC1);
+
+		// скалярный вариант - эталон для всех векторных
+		sobelFusedWithRange(luma.ptr<uchar>(), luma.step, rows, cols, 0, rows - 1,
+		                    reference.ptr<uchar>(), reference.step, fusedMagnitudeScale, SOBEL_ISA_SCALAR);
+
+		for (int isa = SOBEL_ISA_SSE2; isa <= best; isa++)
+		{
+			string what = string(sobelIsaName((SobelKernelIsa)isa)) + " " + to_string(rows) + "x" + to_string(cols);
+
+			// весь кадр одной полосой
+			Mat whole(rows, cols, CV_8UC1);
+			sobelFusedWithRange(luma.ptr<uchar>(), luma.step, rows, cols, 0, rows - 1,
+			                    whole.ptr<uchar>(), whole.step, fusedMagnitudeScale, (SobelKernelIsa)isa);
+			check(sameImage(reference, whole), "слитое ядро " + what);
+
+			// две полосы со строками-ореолами на стыке
+			Mat bands(rows, cols, CV_8UC1);
+			int split = rows / 2;
+			if (split > 0)
+				sobelFusedWithRange(luma.ptr<uchar>(), luma.step, rows, cols, 0, split - 1,
+				                    bands.ptr<uchar>(0), bands.step, fusedMagnitudeScale, (SobelKernelIsa)isa);
+			sobelFusedWithRange(luma.ptr<uchar>(), luma.step, rows, cols, split, rows - 1,
+			                    bands.ptr<uchar>(split), bands.step, fusedMagnitudeScale, (SobelKernelIsa)isa);
+			check(sameImage(reference, bands), "слитое ядро по полосам " + what);
+		}// for isa
+	}// for s
+	return;                                    // возвращаем обещанное функцией значение
+}
+
+
+
+// градиенты по тайлам и полосам против cv::Sobel по всему каналу яркости
+void testSobelTiles()
+{
+	// обычные кадры укладываются в один тайл, а у широкого тайл - всего несколько строк,
+	// поэтому стыки тайлов внутри полосы тоже проверяются
+	const int sizes[][2] = {{1, 9}, {7, 13}, {64, 129}, {41, 9000}};
+	const int bandSizes[3] = {1, 5, 1000};
+
+	for (int s = 0; s < 4; s++)
+	{
+		int rows = sizes[s][0], cols = sizes[s][1];
+		Mat luma = testImage(rows, cols, 1, 60 + s);
+
+		// эталон - Sobel по всему кадру с тем же масштабом, что у цепочки OpenCV
+		Mat expectedX, expectedY;
+		Sobel(luma, expectedX, CV_32F, 1, 0, 3, 3 * sensitivityFactor, 0, BORDER_DEFAULT);
+		Sobel(luma, expectedY, CV_32F, 0, 1, 3, 3 * sensitivityFactor, 0, BORDER_DEFAULT);
+
+		for (int b = 0; b < 3; b++)
+		{
+			Mat gradientX(rows, cols, CV_32FC1), gradientY(rows, cols, CV_32FC1);
+			for (int startRow = 0; startRow < rows; startRow += bandSizes[b])
+			{
+				int endRow = min(rows, startRow + bandSizes[b]) - 1;
+				Mat bandX = gradientX.rowRange(startRow, endRow + 1);
+				Mat bandY = gradientY.rowRange(startRow, endRow + 1);
+				sobelTilesWithRange(luma, bandX, bandY, startRow, endRow);
+			}// for startRow
+
+			string what = "тайлы Собеля " + to_string(rows) + "x" + to_string(cols) + " полоса " + to_string(bandSizes[b]);
+			check(sameImage(expectedX, gradientX), what + ": Gx");
+			check(sameImage(expectedY, gradientY), what + ": Gy");
+		}// for b
+	}// for s
+	return;                                    // возвращаем обещанное функцией значение
+}
+
+
+
+// повышение резкости по полосам против GaussianBlur и addWeighted по всему кадру
+void testUnsharpBands()
+{
+	// кадры ниже и выше ореола размытия: у низких полоса упирается в оба края кадра сразу
+	const int sizes[][2] = {{1, 9}, {7, 13}, {31, 17}, {64, 129}, {97, 250}};
+	const int bandSizes[4] = {1, 5, 40, 1000};
+	ScratchArena arena;                        // арена размытых полос
+
+	for (int s = 0; s < 5; s++)
+	{
+		int rows = sizes[s][0], cols = sizes[s][1];
+		Mat equalized = testImage(rows, cols, 1, 90 + s);
+
+		// эталон - прежняя цепочка по всему кадру: размытие с ядром 31x31 и сигмой 5, затем смешивание
+		Mat blurred, expected;
+		GaussianBlur(equalized, blurred, Size(2 * unsharpRadius + 1, 2 * unsharpRadius + 1), unsharpSigma);
+		addWeighted(equalized, 1.5, blurred, -0.5, 0, expected);
+
+		for (int b = 0; b < 4; b++)
+		{
+			Mat output(rows, cols, CV_8UC1);
+			for (int startRow = 0; startRow < rows; startRow += bandSizes[b])
+			{
+				arena.reset();
+				unsharpWithRange(equalized, output, startRow, min(rows, startRow + bandSizes[b]) - 1, arena);
+			}// for startRow
+
+			check(sameImage(expected, output),
+			      "резкость " + to_string(rows) + "x" + to_string(cols) + " полоса " + to_string(bandSizes[b]));
+		}// for b
+	}// for s
+	return;                                    // возвращаем обещанное функцией значение
+}
+
+
+
+// масштаб магнитуды слитого ядра и его результат против цепочки OpenCV
+void testKernelScale(SobelProcessor& processor)
+{
+	// ступеньки в 160 уровней дают магнитуды больше 255 - раньше слитое ядро сливало их в один столбец
+	Mat luma = testImage(45, 70, 1, 80);
+	int rows = luma.rows, cols = luma.cols;
+
+	// |G| по всему кадру: градиенты Sobel целые и в float точны, сумма квадратов меньше 2^24
+	Mat gradientX, gradientY, reference;
+	Sobel(luma, gradientX, CV_32F, 1, 0, 3, 1, 0, BORDER_DEFAULT);
+	Sobel(luma, gradientY, CV_32F, 0, 1, 3, 1, 0, BORDER_DEFAULT);
+	magnitude(gradientX, gradientY, reference);
+
+	// слитое ядро: |G| * fusedMagnitudeScale в float с округлением к ближайшему; насыщения нет,
+	// потому что даже наибольшая магнитуда 1020 * sqrt(2) переходит ровно в 255
+	Mat expectedFused(rows, cols, CV_8UC1), fused(rows, cols, CV_8UC1);
+	for (int y = 0; y < rows; y++)
+		for (int x = 0; x < cols; x++)
+			expectedFused.ptr<uchar>(y)[x] = saturate_cast<uchar>(reference.ptr<float>(y)[x] * fusedMagnitudeScale);
+	sobelFusedYUVWithRange(luma, fused, 0, rows - 1, sobelDetectIsa());
+	check(sameImage(expectedFused, fused), "слитое ядро: |G| * fusedMagnitudeScale");
+
+	double maxReference = 0, maxFused = 0;
+	minMaxLoc(reference, NULL, &maxReference);
+	minMaxLoc(fused, NULL, &maxFused);
+	check(maxReference > 255 && maxFused < 255, "слитое ядро: магнитуды больше 255 не насыщаются");
+
+	check(lrintf(sqrtf(2.0f * 1020 * 1020) * fusedMagnitudeScale) == 255, "слитое ядро: наибольшая магнитуда - ровно 255");
+
+	// после нормализации слитое ядро отличается от цепочки OpenCV только округлением 8-битной магнитуды
+	Mat input = testImage(97, 250, 3, 81);
+	Mat outputs[2];
+	for (int k = 0; k < 2; k++)
+	{
+		SobelOptions options;                  // нормализованная магнитуда без последующих этапов
+		options.kernel = k == 0 ? SOBEL_KERNEL_FUSED : SOBEL_KERNEL_OPENCV;
+		options.equalize = false;
+		options.unsharp = false;
+		processor.setOptions(options);
+		processor.process(input, outputs[k], 4);
+	}// for k
+
+	int maxDifference = 0;                     // наибольшее расхождение вариантов в уровнях яркости
+	for (int y = 0; y < input.rows; y++)
+		for (int x = 0; x < input.cols; x++)
+			maxDifference = max(maxDifference, abs(outputs[0].ptr<uchar>(y)[x] - outputs[1].ptr<uchar>(y)[x]));
+	check(maxDifference <= 2, "слитое ядро против цепочки OpenCV: расхождение " + to_string(maxDifference));
+	processor.setOptions(SobelOptions());
+	return;                                    // возвращаем обещанное функцией значение
+}
+
+
+
+// результат любого количества потоков и любых порций против одного потока с одной порцией на весь кадр
+void testThreadCounts(SobelProcessor& processor)
+{
+	const SobelKernel kernels[2] = {SOBEL_KERNEL_FUSED, SOBEL_KERNEL_OPENCV};
+	const int chunkSizes[3] = {1, 5, defaultChunkRows};
+
+	for (int s = 0; s < numTestSizes; s++)
+	{
+		int rows = testSizes[s][0], cols = testSizes[s][1];
+		Mat input = testImage(rows, cols, 3, 100 + s);
+
+		for (int k = 0; k < 2; k++)
+			for (int post = 0; post < 4; post++)
+			{
+				SobelOptions options;          // проверяемые настройки
+				options.kernel = kernels[k];
+				options.unsharp = (post & 1) == 0;
+				options.equalize = (post & 2) == 0;
+
+				// эталон - один поток и одна порция на весь кадр: в нём нет ни одного стыка порций,
+				// поэтому ошибка в ореолах на стыке не может повториться в эталоне
+				options.chunkRows = rows;
+				processor.setOptions(options);
+				Mat reference;
+				processor.process(input, reference, 1);
+
+				// без перехвата каждый поток обрабатывает только свою очередь - статическое разбиение
+				for (int c = 0; c < 6; c++)
+				{
+					options.chunkRows = chunkSizes[c % 3];
+					options.steal = c < 3;
+					processor.setOptions(options);
+
+					for (int threads = 1; threads <= testMaxThreads; threads++)
+					{
+						Mat output;
+						processor.process(input, output, threads);
+						string what = string(k == 0 ? "fused " : "opencv ") + to_string(rows) + "x" + to_string(cols) +
+						              " chunk=" + to_string(chunkSizes[c % 3]) + (options.steal ? "" : " без перехвата") +
+						              (options.unsharp ? "" : " без резкости") + (options.equalize ? "" : " без выравнивания") +
+						              " потоков " + to_string(threads);
+						check(sameImage(reference, output), what);
+						int stolen = 0;            // перехваченных порций во всех задачах
+						for (int worker = 0; worker < threads; worker++)
+							stolen += processor.stolenCount(worker);
+						check(options.steal || stolen == 0, what + ": перехватов нет");
+					}// for threads
+				}// for c
+			}// for post
+	}// for s
+	processor.setOptions(SobelOptions());
+	return;                                    // возвращаем обещанное функцией значение
+}
+
+
+
+// обработчик с набором инструкций из настроек против набора по умолчанию
+void testIsaOption(SobelProcessor& processor)
+{
+	Mat input = testImage(53, 201, 3, 11);
+	Mat expected;
+	SobelOptions options;                      // слитое ядро - набор инструкций есть только у него
+	options.kernel = SOBEL_KERNEL_FUSED;
+	processor.setOptions(options);
+	processor.process(input, expected, 4);
+
+	for (int isa = SOBEL_ISA_SCALAR; isa <= SOBEL_ISA_AVX2; isa++)
+	{
+		options.isa = (SobelKernelIsa)isa;
+		processor.setOptions(options);
+
+		// набор больше поддерживаемого процессором ограничивается поддерживаемым
+		string what = string("набор инструкций ") + sobelIsaName((SobelKernelIsa)isa);
+		check(processor.kernelIsa() == min((SobelKernelIsa)isa, processor.isa()), what + ": ограничение");
+
+		Mat output;
+		processor.process(input, output, 4);
+		check(sameImage(expected, output), what);
+	}// for isa
+	processor.setOptions(SobelOptions());
+	return;                                    // возвращаем обещанное функцией значение
+}
+
+
+
+// оттенки серого и BGRA против равносильного BGR
+void testInputFormats(SobelProcessor& processor)
+{
+	Mat gray = testImage(37, 61, 1, 5);        // оттенки серого
+	Mat bgra = testImage(37, 61, 4, 6);        // BGRA
+	Mat grayBgr(gray.size(), CV_8UC3);         // тот же серый в трёх одинаковых каналах
+	Mat bgr(bgra.size(), CV_8UC3);             // тот же BGRA без альфа-канала
+
+	for (int y = 0; y < gray.rows; y++)
+		for (int x = 0; x < gray.cols; x++)
+			for (int channel = 0; channel < 3; channel++)
+			{
+				grayBgr.ptr<uchar>(y)[3 * x + channel] = gray.ptr<uchar>(y)[x];
+				bgr.ptr<uchar>(y)[3 * x + channel] = bgra.ptr<uchar>(y)[4 * x + channel];
+			}// for channel
+
+	Mat expected, actual;
+	processor.process(grayBgr, expected, 4);
+	processor.process(gray, actual, 4);
+	check(sameImage(expected, actual), "оттенки серого против BGR");
+
+	processor.process(bgr, expected, 4);
+	processor.process(bgra, actual, 4);
+	check(sameImage(expected, actual), "BGRA против BGR");
+	return;                                    // возвращаем обещанное функцией значение
+}
+
+
+
+// обработка сырых буферов вызывающего с произвольным шагом строк
+void testRawBuffers(SobelProcessor& processor)
+{
+	int rows = 29, cols = 45;                  // размер кадра
+	size_t inputStep = cols * 3 + 11;          // шаг строк с хвостом, как у выровненных буферов
+	size_t outputStep = cols + 5;
+	Mat input = testImage(rows, cols, 3, 9);
+
+	vector<unsigned char> inputBuffer(rows * inputStep, 0);
+	vector<unsigned char> outputBuffer(rows * outputStep, 0xAB);
+	for (int y = 0; y < rows; y++)
+		memcpy(&inputBuffer[y * inputStep], input.ptr<uchar>(y), cols * 3);
+
+	Mat expected;
+	processor.process(input, expected, 8);
+	processor.process(&inputBuffer[0], rows, cols, 3, inputStep, &outputBuffer[0], outputStep);
+
+	// результат - в буфере вызывающего, хвосты строк не тронуты
+	bool tailsKept = true;                     // байты за пределами строк остались прежними
+	for (int y = 0; y < rows; y++)
+		for (size_t x = cols; x < outputStep; x++)
+			tailsKept = tailsKept && outputBuffer[y * outputStep + x] == 0xAB;
+	check(sameImage(expected, Mat(rows, cols, CV_8UC1, &outputBuffer[0], outputStep)), "сырые буферы");
+	check(tailsKept, "сырые буферы: хвосты строк");
+	return;                                    // возвращаем обещанное функцией значение
+}
+
+
+
+// запись файла: заголовок и строки изображения, при необходимости с перестановкой BGR в RGB
+static bool writeTestFile(const string& path,  // путь до файла
+                          const string& header,// заголовок PGM/PPM или пусто для сырых пикселей
+                          const Mat& image,    // изображение
+                          bool swapRedBlue)    // записывать ли каналы в порядке RGB
+{
+	FILE* file = fopen(path.c_str(), "wb");
+	if (!file)
+		return false;
+
+	fwrite(header.data(), 1, header.size(), file);
+	vector<uchar> row(image.cols * image.elemSize());
+	for (int y = 0; y < image.rows; y++)
+	{
+		memcpy(&row[0], image.ptr<uchar>(y), row.size());
+		if (swapRedBlue)
+			for (int x = 0; x < image.cols; x++)
+				swap(row[3 * x], row[3 * x + 2]);
+		fwrite(&row[0], 1, row.size(), file);
+	}// for y
+	return fclose(file) == 0;
+}
+
+
+
+// пустой кадр отклоняется исключением, и обработчик после этого продолжает работать
+void testEmptyInput(SobelProcessor& processor)
+{
+	Mat output;
+	bool thrown = false;                       // брошено ли исключение
+	try
+	{
+		processor.process(Mat(), output);
+	}// try
+	catch (const cv::Exception&)
+	{
+		thrown = true;
+	}// catch
+	check(thrown, "пустой кадр: исключение");
+	check(output.empty(), "пустой кадр: выходное изображение не создано");
+
+	// сырой буфер без строк - тот же пустой кадр
+	unsigned char pixels[3] = {0, 0, 0};
+	thrown = false;
+	try
+	{
+		processor.process(pixels, 0, 1, 3, 3, pixels, 1);
+	}// try
+	catch (const cv::Exception&)
+	{
+		thrown = true;
+	}// catch
+	check(thrown, "пустой сырой буфер: исключение");
+
+	// исключение бросается до постановки задач, поэтому пул не остался ждать на барьере
+	Mat input = testImage(19, 23, 3, 5);
+	Mat expected;
+	processor.process(input, expected, 1);
+	processor.process(input, output, 4);
+	check(sameImage(expected, output), "кадр после пустого");
+	return;                                    // возвращаем обещанное функцией значение
+}
+
+
+
+// потоковая обработка файлов PPM, PGM и сырых пикселей против обработки в памяти слитым ядром
+void testStream(SobelProcessor& processor)
+{
+	const string inputPath = "sobel_stream_test.in";   // входной файл проверки
+	const string outputPath = "sobel_stream_test.pgm"; // выходной файл проверки
+	SobelOptions options;                      // потоковая обработка считает магнитуду только слитым ядром
+	options.kernel = SOBEL_KERNEL_FUSED;
+	processor.setOptions(options);
+
+	for (int format = 0; format < 3; format++)
+	{
+		// PPM (RGB), PGM с комментарием в заголовке и сырой BGRA
+		int channels = format == 0 ? 3 : (format == 1 ? 1 : 4);
+		Mat input = testImage(83, 57, channels, 40 + format);
+		string header, rawFormat;
+		if (format == 0)
+			header = "P6\n57 83\n255\n";
+		else if (format == 1)
+			header = "P5\n# проверка\n57 83\n255\n";
+		else
+			rawFormat = "57x83x4";
+		check(writeTestFile(inputPath, header, input, format == 0), "запись входного файла");
+
+		Mat expected;
+		processor.process(input, expected, 4);
+
+		// полосы короче ореола размытия и областей меньше, чем ореол, - самые неудобные для переносов
+		const int threadCounts[3] = {1, 3, 8};
+		const int stripSizes[3] = {1, 7, 200};
+		for (int t = 0; t < 3; t++)
+			for (int s = 0; s < 3; s++)
+			{
+				string what = "потоковая обработка формата " + to_string(format) + " потоков " +
+				              to_string(threadCounts[t]) + " полоса " + to_string(stripSizes[s]);
+				int result = runStream(inputPath, outputPath, rawFormat, threadCounts[t], stripSizes[s], false);
+				check(result == 0, what + ": код " + to_string(result));
+
+				MappedImage output;
+				bool opened = output.open(outputPath, "");
+				check(opened && output.channels() == 1, what + ": выходной PGM");
+				if (opened)
+					check(sameImage(expected, Mat(output.rows(), output.cols(), CV_8UC1, output.row(0), output.step())), what);
+			}// for s
+	}// for format
+
+	// выход поверх входа отвергается до того, как вход будет обрезан
+	int result = runStream(inputPath, inputPath, "57x83x4", 2, 7, false);
+	MappedImage kept;
+	check(result == -6, "потоковая обработка: выход совпадает со входом, код " + to_string(result));
+	check(kept.open(inputPath, "57x83x4"), "потоковая обработка: вход не обрезан");
+
+	remove(inputPath.c_str());
+	remove(outputPath.c_str());
+	return;                                    // возвращаем обещанное функцией значение
+}
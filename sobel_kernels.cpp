@@ -0,0 +1,283 @@
+#include "sobel_kernels.h"         // заголовочный файл слитого ядра Собеля
+#include <cmath>                    // заголовочный файл для sqrtf и lrintf
+
+#if defined(__x86_64__) || defined(__i386__)
+#define SOBEL_KERNELS_X86           // векторные варианты доступны только на x86
+#include <emmintrin.h>              // заголовочный файл с инструкциями SSE2
+#include <immintrin.h>              // заголовочный файл с инструкциями AVX2
+#endif
+
+
+
+/*------------------------------------------------------------------------*/
+/*          Скалярный вариант           */
+/*--------------------------------------*/
+
+// вычисление одного пикселя результата по трём строкам и трём столбцам: xl, x, xr - соседние столбцы
+// (на краях строки они уже отражены). Скалярный и векторные варианты считают одинаково:
+// целые Gx и Gy, сумма квадратов в float (точно, т.к. меньше 2^24), корень, масштаб,
+// ограничение сверху 255 и округление к ближайшему чётному - результат совпадает побитово
+static inline unsigned char sobelPixel(const unsigned char* above, const unsigned char* center, const unsigned char* below,
+                                       int xl, int x, int xr, float scale)
+{
+    // горизонтальный градиент: ядро [-1 0 1; -2 0 2; -1 0 1]
+    int gx = (above[xr] - above[xl]) + 2 * (center[xr] - center[xl]) + (below[xr] - below[xl]);
+    // вертикальный градиент: ядро [-1 -2 -1; 0 0 0; 1 2 1]
+    int gy = (below[xl] + 2 * below[x] + below[xr]) - (above[xl] + 2 * above[x] + above[xr]);
+
+    float value = sqrtf((float)(gx * gx + gy * gy)) * scale;
+
+    // насыщение до 8 бит: сверху - до округления, как в векторных вариантах; снизу магнитуда не бывает меньше 0
+    if (value > 255.0f)
+        value = 255.0f;
+    return (unsigned char)lrintf(value);
+}
+
+
+
+// обработка строки скалярным кодом
+static void sobelRowScalar(const unsigned char* above, const unsigned char* center, const unsigned char* below,
+                           unsigned char* dst, int width, float scale)
+{
+    // проход по всем пикселям строки с отражением BORDER_REFLECT_101 на левом и правом краю
+    for (int x = 0; x < width; x++)
+    {
+        int xl = (x > 0) ? x - 1 : (width > 1 ? 1 : 0);
+        int xr = (x < width - 1) ? x + 1 : (width > 1 ? width - 2 : 0);
+        dst[x] = sobelPixel(above, center, below, xl, x, xr, scale);
+    }// for x
+    return;                                    // возвращаем обещанное функцией значение
+}
+
+
+
+// обработка краёв строки и хвоста, не кратного ширине вектора, после векторного цикла
+// x - первый необработанный векторным циклом пиксель
+static void sobelRowTail(const unsigned char* above, const unsigned char* center, const unsigned char* below,
+                         unsigned char* dst, int width, float scale, int x)
+{
+    // левый край: столбец -1 отражается в столбец 1
+    dst[0] = sobelPixel(above, center, below, 1, 0, 1, scale);
+
+    // оставшиеся внутренние пиксели
+    for (; x < width - 1; x++)
+        dst[x] = sobelPixel(above, center, below, x - 1, x, x + 1, scale);
+
+    // правый край: столбец width отражается в столбец width - 2
+    dst[width - 1] = sobelPixel(above, center, below, width - 2, width - 1, width - 2, scale);
+    return;                                    // возвращаем обещанное функцией значение
+}
+
+
+
+#ifdef SOBEL_KERNELS_X86
+
+/*------------------------------------------------------------------------*/
+/*            Вариант SSE2              */
+/*--------------------------------------*/
+
+// обработка строки инструкциями SSE2: 8 пикселей за итерацию в 16-битной арифметике
+static void sobelRowSSE2(const unsigned char* above, const unsigned char* center, const unsigned char* below,
+                         unsigned char* dst, int width, float scale)
+{
+    // строки уже 3 пикселей не содержат внутренних пикселей для векторного цикла
+    if (width < 3)
+    {
+        sobelRowScalar(above, center, below, dst, width, scale);
+        return;
+    }// if
+
+    const __m128i zero = _mm_setzero_si128();
+    const __m128 scaleVector = _mm_set1_ps(scale);
+    const __m128 maxVector = _mm_set1_ps(255.0f);
+
+    int x = 1;                                 // первый внутренний пиксель
+
+    // векторный цикл: читаются столбцы от x - 1 до x + 8, поэтому x + 8 не должен выходить за строку
+    for (; x + 8 <= width - 1; x += 8)
+    {
+        // загрузка по 8 байт со сдвигами -1, 0, +1 и расширение до 16 бит
+        __m128i aL = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(above + x - 1)), zero);
+        __m128i aC = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(above + x)), zero);
+        __m128i aR = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(above + x + 1)), zero);
+        __m128i cL = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(center + x - 1)), zero);
+        __m128i cR = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(center + x + 1)), zero);
+        __m128i bL = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(below + x - 1)), zero);
+        __m128i bC = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(below + x)), zero);
+        __m128i bR = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(below + x + 1)), zero);
+
+        // Gx = (aR - aL) + 2 * (cR - cL) + (bR - bL), по модулю не больше 1020 - помещается в 16 бит
+        __m128i cDiff = _mm_sub_epi16(cR, cL);
+        __m128i gx = _mm_add_epi16(_mm_add_epi16(_mm_sub_epi16(aR, aL), _mm_sub_epi16(bR, bL)), _mm_add_epi16(cDiff, cDiff));
+
+        // Gy = (bL + 2 * bC + bR) - (aL + 2 * aC + aR)
+        __m128i bSum = _mm_add_epi16(_mm_add_epi16(bL, bR), _mm_add_epi16(bC, bC));
+        __m128i aSum = _mm_add_epi16(_mm_add_epi16(aL, aR), _mm_add_epi16(aC, aC));
+        __m128i gy = _mm_sub_epi16(bSum, aSum);
+
+        // Gx^2 + Gy^2 в 32 бит: чередуем пары (Gx, Gy) и перемножаем со сложением соседей
+        __m128i lo = _mm_unpacklo_epi16(gx, gy);
+        __m128i hi = _mm_unpackhi_epi16(gx, gy);
+        __m128i sumLo = _mm_madd_epi16(lo, lo);
+        __m128i sumHi = _mm_madd_epi16(hi, hi);
+
+        // корень, масштаб и ограничение сверху в float
+        __m128 magLo = _mm_min_ps(_mm_mul_ps(_mm_sqrt_ps(_mm_cvtepi32_ps(sumLo)), scaleVector), maxVector);
+        __m128 magHi = _mm_min_ps(_mm_mul_ps(_mm_sqrt_ps(_mm_cvtepi32_ps(sumHi)), scaleVector), maxVector);
+
+        // округление к ближайшему чётному и упаковка с насыщением 32 -> 16 -> 8 бит
+        __m128i packed = _mm_packs_epi32(_mm_cvtps_epi32(magLo), _mm_cvtps_epi32(magHi));
+        _mm_storel_epi64((__m128i*)(dst + x), _mm_packus_epi16(packed, packed));
+    }// for x
+
+    // края строки и хвост
+    sobelRowTail(above, center, below, dst, width, scale, x);
+    return;                                    // возвращаем обещанное функцией значение
+}
+
+
+
+/*------------------------------------------------------------------------*/
+/*            Вариант AVX2              */
+/*--------------------------------------*/
+
+// обработка строки инструкциями AVX2: 16 пикселей за итерацию в 16-битной арифметике.
+// Функция компилируется с target("avx2"), поэтому весь остальной код собирается без -mavx2,
+// а вызывается она только после проверки процессора в sobelDetectIsa
+__attribute__((target("avx2")))
+static void sobelRowAVX2(const unsigned char* above, const unsigned char* center, const unsigned char* below,
+                         unsigned char* dst, int width, float scale)
+{
+    // строки уже 3 пикселей не содержат внутренних пикселей для векторного цикла
+    if (width < 3)
+    {
+        sobelRowScalar(above, center, below, dst, width, scale);
+        return;
+    }// if
+
+    const __m256 scaleVector = _mm256_set1_ps(scale);
+    const __m256 maxVector = _mm256_set1_ps(255.0f);
+
+    int x = 1;                                 // первый внутренний пиксель
+
+    // векторный цикл: читаются столбцы от x - 1 до x + 16, поэтому x + 16 не должен выходить за строку
+    for (; x + 16 <= width - 1; x += 16)
+    {
+        // загрузка по 16 байт со сдвигами -1, 0, +1 и расширение до 16 бит
+        __m256i aL = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)(above + x - 1)));
+        __m256i aC = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)(above + x)));
+        __m256i aR = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)(above + x + 1)));
+        __m256i cL = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)(center + x - 1)));
+        __m256i cR = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)(center + x + 1)));
+        __m256i bL = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)(below + x - 1)));
+        __m256i bC = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)(below + x)));
+        __m256i bR = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)(below + x + 1)));
+
+        // Gx = (aR - aL) + 2 * (cR - cL) + (bR - bL)
+        __m256i cDiff = _mm256_sub_epi16(cR, cL);
+        __m256i gx = _mm256_add_epi16(_mm256_add_epi16(_mm256_sub_epi16(aR, aL), _mm256_sub_epi16(bR, bL)), _mm256_add_epi16(cDiff, cDiff));
+
+        // Gy = (bL + 2 * bC + bR) - (aL + 2 * aC + aR)
+        __m256i bSum = _mm256_add_epi16(_mm256_add_epi16(bL, bR), _mm256_add_epi16(bC, bC));
+        __m256i aSum = _mm256_add_epi16(_mm256_add_epi16(aL, aR), _mm256_add_epi16(aC, aC));
+        __m256i gy = _mm256_sub_epi16(bSum, aSum);
+
+        // Gx^2 + Gy^2 в 32 бит. Чередование работает внутри 128-битных половин:
+        // lo содержит пиксели 0-3 и 8-11, hi - пиксели 4-7 и 12-15
+        __m256i lo = _mm256_unpacklo_epi16(gx, gy);
+        __m256i hi = _mm256_unpackhi_epi16(gx, gy);
+        __m256i sumLo = _mm256_madd_epi16(lo, lo);
+        __m256i sumHi = _mm256_madd_epi16(hi, hi);
+
+        // корень, масштаб и ограничение сверху в float
+        __m256 magLo = _mm256_min_ps(_mm256_mul_ps(_mm256_sqrt_ps(_mm256_cvtepi32_ps(sumLo)), scaleVector), maxVector);
+        __m256 magHi = _mm256_min_ps(_mm256_mul_ps(_mm256_sqrt_ps(_mm256_cvtepi32_ps(sumHi)), scaleVector), maxVector);
+
+        // упаковка 32 -> 16 бит тоже идёт по половинам и возвращает пиксели в порядок 0-15
+        __m256i packed = _mm256_packs_epi32(_mm256_cvtps_epi32(magLo), _mm256_cvtps_epi32(magHi));
+
+        // упаковка 16 -> 8 бит с насыщением из двух 128-битных половин
+        __m128i result = _mm_packus_epi16(_mm256_castsi256_si128(packed), _mm256_extracti128_si256(packed, 1));
+        _mm_storeu_si128((__m128i*)(dst + x), result);
+    }// for x
+
+    // края строки и хвост
+    sobelRowTail(above, center, below, dst, width, scale, x);
+    return;                                    // возвращаем обещанное функцией значение
+}
+
+#endif // SOBEL_KERNELS_X86
+
+
+
+/*------------------------------------------------------------------------*/
+/*                Функции               */
+/*--------------------------------------*/
+
+// определение лучшего набора инструкций, поддерживаемого процессором, во время выполнения
+SobelKernelIsa sobelDetectIsa()
+{
+#ifdef SOBEL_KERNELS_X86
+    __builtin_cpu_init();                      // инициализация сведений о процессоре (нужна до main, вызов безопасен повторно)
+
+    if (__builtin_cpu_supports("avx2"))
+        return SOBEL_ISA_AVX2;
+    if (__builtin_cpu_supports("sse2"))
+        return SOBEL_ISA_SSE2;
+#endif
+    return SOBEL_ISA_SCALAR;
+}
+
+
+
+// название набора инструкций для вывода на экран
+const char* sobelIsaName(SobelKernelIsa isa)
+{
+    switch (isa)
+    {
+        case SOBEL_ISA_AVX2: return "AVX2";
+        case SOBEL_ISA_SSE2: return "SSE2";
+        case SOBEL_ISA_AUTO: return "auto";
+        default:             return "scalar";
+    }// switch
+}
+
+
+
+// функция обработки строки для заданного набора инструкций
+SobelRowFunc sobelRowFunc(SobelKernelIsa isa)
+{
+    if (isa == SOBEL_ISA_AUTO)
+        isa = sobelDetectIsa();
+
+#ifdef SOBEL_KERNELS_X86
+    if (isa == SOBEL_ISA_AVX2)
+        return sobelRowAVX2;
+    if (isa == SOBEL_ISA_SSE2)
+        return sobelRowSSE2;
+#endif
+    (void)isa;                                 // без x86 остаётся только скалярный вариант
+    return sobelRowScalar;
+}
+
+
+
+// слитое ядро: Gx, Gy, масштабированная магнитуда и насыщение до 8 бит за один проход по строкам [startRow, endRow]
+void sobelFusedWithRange(const unsigned char* luma, size_t lumaStep, int rows, int cols,
+                         int startRow, int endRow, unsigned char* dst, size_t dstStep,
+                         float scale, SobelKernelIsa isa)
+{
+    SobelRowFunc rowFunc = sobelRowFunc(isa);  // выбор варианта один раз на полосу, а не на строку
+
+    // проход по строкам полосы; строки-ореолы над и под полосой читаются из общего канала яркости
+    for (int y = startRow; y <= endRow; y++)
+    {
+        // отражение BORDER_REFLECT_101 по вертикали на верхнем и нижнем краю кадра
+        int yAbove = (y > 0) ? y - 1 : (rows > 1 ? 1 : 0);
+        int yBelow = (y < rows - 1) ? y + 1 : (rows > 1 ? rows - 2 : 0);
+
+        rowFunc(luma + yAbove * lumaStep, luma + y * lumaStep, luma + yBelow * lumaStep,
+                dst + (y - startRow) * dstStep, cols, scale);
+    }// for y
+    return;                                    // возвращаем обещанное функцией значение
+}
@@ -0,0 +1,57 @@
+#ifndef SOBEL_KERNELS_H
+#define SOBEL_KERNELS_H
+
+#include <cstddef>                  // заголовочный файл для типа size_t
+
+
+
+/**************************************************************************/
+/*                       Т И П Ы   Д А Н Н Ы Х                            */
+/**************************************************************************/
+
+// набор инструкций, которым выполняется слитое ядро Собеля
+enum SobelKernelIsa
+{
+    SOBEL_ISA_AUTO = -1,            // лучший набор, поддерживаемый процессором (sobelDetectIsa)
+    SOBEL_ISA_SCALAR,               // скалярный код - эталон для проверки векторных вариантов
+    SOBEL_ISA_SSE2,                 // 8 пикселей за итерацию на 128-битных регистрах
+    SOBEL_ISA_AVX2                  // 16 пикселей за итерацию на 256-битных регистрах
+};// SobelKernelIsa
+
+// функция обработки одной строки слитым ядром: три соседние строки яркости на входе, строка 8-бит на выходе
+typedef void (*SobelRowFunc)(const unsigned char* above,  // строка над текущей (уже с учётом отражения на краю кадра)
+                             const unsigned char* center, // текущая строка
+                             const unsigned char* below,  // строка под текущей (уже с учётом отражения на краю кадра)
+                             unsigned char* dst,          // строка результата
+                             int width,                   // ширина строки в пикселях
+                             float scale);                // масштаб магнитуды градиента
+
+
+
+/**************************************************************************/
+/*                  П Р О Т О Т И П Ы   Ф У Н К Ц И Й                     */
+/**************************************************************************/
+
+// определение лучшего набора инструкций, поддерживаемого процессором, во время выполнения
+SobelKernelIsa sobelDetectIsa();
+
+// название набора инструкций для вывода на экран
+const char* sobelIsaName(SobelKernelIsa isa);
+
+// функция обработки строки для заданного набора инструкций
+SobelRowFunc sobelRowFunc(SobelKernelIsa isa);
+
+// слитое ядро: Gx, Gy, масштабированная магнитуда и насыщение до 8 бит за один проход по строкам [startRow, endRow].
+// Строки за пределами диапазона читаются как ореол, на краях кадра используется отражение BORDER_REFLECT_101
+void sobelFusedWithRange(const unsigned char* luma,       // канал яркости всего кадра
+                         size_t lumaStep,                 // шаг строки канала яркости в байтах
+                         int rows,                        // количество строк кадра
+                         int cols,                        // количество столбцов кадра
+                         int startRow,                    // начальная строка полосы
+                         int endRow,                      // конечная строка полосы
+                         unsigned char* dst,              // результат полосы: строка startRow кадра пишется в dst
+                         size_t dstStep,                  // шаг строки результата в байтах
+                         float scale,                     // масштаб магнитуды градиента
+                         SobelKernelIsa isa);             // набор инструкций
+
+#endif // SOBEL_KERNELS_H
@@ -0,0 +1,342 @@
+#include "stage_trace.h"            // заголовочный файл трассировки этапов
+#include <fstream>                  // заголовочный файл для записи JSON
+#include <cstdio>                   // заголовочный файл для snprintf
+#include <cstring>                  // заголовочный файл для strcmp
+#include <vector>                   // заголовочный файл динамических массивов буферов и сводки
+#include <algorithm>                // заголовочный файл для max
+#include <pthread.h>                // заголовочный файл мьютекса списка буферов
+#include <time.h>                   // заголовочный файл для clock_gettime
+
+using namespace std;                // используем пространство имён std
+
+
+
+#ifdef SOBEL_TRACE
+
+/**************************************************************************/
+/*                       Т И П Ы   Д А Н Н Ы Х                            */
+/**************************************************************************/
+
+// записанный отрезок времени этапа
+struct TraceEvent
+{
+    const char* name;               // имя этапа
+    unsigned long long begin;       // начало в наносекундах
+    unsigned long long end;         // окончание в наносекундах
+};// TraceEvent
+
+// кольцевой буфер отрезков одного потока. Пишет в него только сам поток
+struct TraceRing
+{
+    vector<TraceEvent> events;      // отрезки, events[next] - самый старый после заполнения
+    size_t next;                    // куда писать следующий отрезок
+    unsigned long long total;       // всего записано отрезков, включая затёртые
+    int thread;                     // номер потока в трассировке
+    string name;                    // имя потока
+};// TraceRing
+
+// список буферов всех потоков. Буферы живут до конца программы: трассировку читают уже после
+// завершения рабочих потоков
+struct TraceRegistry
+{
+    pthread_mutex_t mutex;          // мьютекс, защищающий список при появлении нового потока
+    vector<TraceRing*> rings;       // буферы потоков в порядке их первого отрезка
+
+    TraceRegistry()
+    {
+        pthread_mutex_init(&mutex, NULL);
+    }
+
+    ~TraceRegistry()
+    {
+        for (size_t i = 0; i < rings.size(); i++)
+            delete rings[i];
+        pthread_mutex_destroy(&mutex);
+    }
+};// TraceRegistry
+
+static TraceRegistry registry;             // буферы всех потоков
+static thread_local TraceRing* ownRing = NULL; // буфер текущего потока
+
+
+
+/*------------------------------------------------------------------------*/
+/*                Функции               */
+/*--------------------------------------*/
+
+// текущее время монотонных часов в наносекундах
+static inline unsigned long long traceNow()
+{
+    timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (unsigned long long)now.tv_sec * 1000000000ull + now.tv_nsec;
+}
+
+
+
+// буфер текущего потока; создаётся при первом отрезке потока - единственное место с мьютексом
+static TraceRing* traceRing()
+{
+    if (!ownRing)
+    {
+        TraceRing* ring = new TraceRing;       // новый буфер потока
+        ring->events.resize(traceRingSpans);
+        ring->next = 0;
+        ring->total = 0;
+
+        pthread_mutex_lock(&registry.mutex);
+        ring->thread = (int)registry.rings.size();
+        registry.rings.push_back(ring);
+        pthread_mutex_unlock(&registry.mutex);
+
+        ownRing = ring;
+    }// if
+    return ownRing;
+}
+
+
+
+TraceSpanScope::TraceSpanScope(const char* name)
+    : name(name), begin(traceNow())
+{
+}
+
+
+
+TraceSpanScope::~TraceSpanScope()
+{
+    TraceRing* ring = traceRing();             // буфер текущего потока
+    TraceEvent& event = ring->events[ring->next];
+    event.name = name;
+    event.begin = begin;
+    event.end = traceNow();
+
+    ring->next = (ring->next + 1) % ring->events.size();
+    ring->total++;
+}
+
+
+
+// имя потока в трассировке
+void traceThreadName(const char* name)
+{
+    traceRing()->name = name;
+    return;                                    // возвращаем обещанное функцией значение
+}
+
+
+
+// собрана ли программа с трассировкой
+bool traceEnabled()
+{
+    return true;
+}
+
+
+
+// удаление всех записанных отрезков
+void traceReset()
+{
+    pthread_mutex_lock(&registry.mutex);
+    for (size_t i = 0; i < registry.rings.size(); i++)
+    {
+        registry.rings[i]->next = 0;
+        registry.rings[i]->total = 0;
+    }// for i
+    pthread_mutex_unlock(&registry.mutex);
+    return;                                    // возвращаем обещанное функцией значение
+}
+
+
+
+// количество сохранившихся отрезков буфера и номер самого старого из них
+static void ringRange(const TraceRing* ring, size_t& first, size_t& count)
+{
+    size_t capacity = ring->events.size();     // ёмкость буфера
+    count = (size_t)min<unsigned long long>(ring->total, capacity);
+    first = ring->total > capacity ? ring->next : 0;
+    return;                                    // возвращаем обещанное функцией значение
+}
+
+
+
+// строка, безопасная внутри кавычек JSON
+static string jsonEscape(const string& text)
+{
+    string escaped;                            // результат
+    for (size_t i = 0; i < text.size(); i++)
+    {
+        if (text[i] == '"' || text[i] == '\\')
+            escaped += '\\';
+        escaped += text[i];
+    }// for i
+    return escaped;
+}
+
+
+
+// запись отрезков всех потоков в формате Chrome trace event
+bool traceWriteChrome(const string& path)     // путь до JSON-файла
+{
+    ofstream file(path.c_str());
+    if (!file)
+        return false;
+
+    pthread_mutex_lock(&registry.mutex);
+
+    // отсчёт времени - от самого раннего отрезка, чтобы метки были небольшими
+    unsigned long long origin = ~0ull;         // самое раннее начало
+    for (size_t r = 0; r < registry.rings.size(); r++)
+    {
+        size_t first, count;
+        ringRange(registry.rings[r], first, count);
+        for (size_t i = 0; i < count; i++)
+            origin = min(origin, registry.rings[r]->events[(first + i) % registry.rings[r]->events.size()].begin);
+    }// for r
+
+    file << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n";
+    bool firstLine = true;                     // перед первой записью запятая не нужна
+    char line[256];                            // очередная запись
+    for (size_t r = 0; r < registry.rings.size(); r++)
+    {
+        const TraceRing* ring = registry.rings[r];
+
+        // имя потока - метаданные, по которым просмотрщик подписывает дорожки
+        string name = ring->name.empty() ? "thread " + to_string(ring->thread) : ring->name;
+        file << (firstLine ? "" : ",\n") << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": "
+             << ring->thread << ", \"args\": {\"name\": \"" << jsonEscape(name) << "\"}}";
+        firstLine = false;
+
+        size_t first, count;
+        ringRange(ring, first, count);
+        for (size_t i = 0; i < count; i++)
+        {
+            const TraceEvent& event = ring->events[(first + i) % ring->events.size()];
+
+            // полный отрезок "X": начало и длительность в микросекундах
+            snprintf(line, sizeof(line), ",\n{\"name\": \"%s\", \"ph\": \"X\", \"pid\": 1, \"tid\": %d, \"ts\": %.3f, \"dur\": %.3f}",
+                     event.name, ring->thread, (event.begin - origin) / 1e3, (event.end - event.begin) / 1e3);
+            file << line;
+        }// for i
+    }// for r
+    file << "\n]}\n";
+
+    pthread_mutex_unlock(&registry.mutex);
+    return (bool)file;
+}
+
+
+
+// сводная таблица по этапам
+void tracePrintSummary(ostream& out)           // поток вывода
+{
+    // итоги одного этапа
+    struct StageSummary
+    {
+        const char* name;                      // имя этапа
+        unsigned long long spans;              // количество отрезков
+        unsigned long long totalNs;            // суммарное время
+        unsigned long long maxNs;              // наибольший отрезок
+        vector<unsigned long long> threadNs;   // суммарное время по потокам
+    };
+    vector<StageSummary> stages;               // этапы в порядке первого появления
+    unsigned long long dropped = 0;            // затёртых отрезков
+
+    pthread_mutex_lock(&registry.mutex);
+    size_t numRings = registry.rings.size();   // количество потоков в трассировке
+    for (size_t r = 0; r < numRings; r++)
+    {
+        const TraceRing* ring = registry.rings[r];
+        size_t first, count;
+        ringRange(ring, first, count);
+        dropped += ring->total - count;
+
+        for (size_t i = 0; i < count; i++)
+        {
+            const TraceEvent& event = ring->events[(first + i) % ring->events.size()];
+
+            // этапов немного, поэтому линейный поиск по имени
+            size_t s = 0;
+            while (s < stages.size() && strcmp(stages[s].name, event.name) != 0)
+                s++;
+            if (s == stages.size())
+            {
+                StageSummary stage;
+                stage.name = event.name;
+                stage.spans = 0;
+                stage.totalNs = 0;
+                stage.maxNs = 0;
+                stage.threadNs.assign(numRings, 0);
+                stages.push_back(stage);
+            }// if
+
+            unsigned long long duration = event.end - event.begin;
+            stages[s].spans++;
+            stages[s].totalNs += duration;
+            stages[s].maxNs = max(stages[s].maxNs, duration);
+            stages[s].threadNs[r] += duration;
+        }// for i
+    }// for r
+    pthread_mutex_unlock(&registry.mutex);
+
+    char line[256];                            // очередная строка таблицы
+    snprintf(line, sizeof(line), "%-16s %10s %12s %12s %12s %8s %10s\n",
+             "stage", "spans", "total_ms", "mean_us", "max_us", "threads", "imbalance");
+    out << line;
+    for (size_t s = 0; s < stages.size(); s++)
+    {
+        // дисбаланс: 1 - потоки заняты этапом поровну, больше 1 - кто-то работает, пока остальные ждут
+        unsigned long long busiest = 0;        // наибольшая сумма одного потока
+        int threads = 0;                       // потоков, у которых есть отрезки этапа
+        for (size_t r = 0; r < numRings; r++)
+        {
+            if (stages[s].threadNs[r] == 0)
+                continue;
+            busiest = max(busiest, stages[s].threadNs[r]);
+            threads++;
+        }// for r
+        double meanThreadNs = threads > 0 ? (double)stages[s].totalNs / threads : 0;
+
+        snprintf(line, sizeof(line), "%-16s %10llu %12.3f %12.3f %12.3f %8d %10.2f\n",
+                 stages[s].name, stages[s].spans, stages[s].totalNs / 1e6, stages[s].totalNs / 1e3 / stages[s].spans,
+                 stages[s].maxNs / 1e3, threads, meanThreadNs > 0 ? busiest / meanThreadNs : 0);
+        out << line;
+    }// for s
+
+    if (dropped > 0)
+        out << "Затёрто старых отрезков: " << dropped << " - увеличьте traceRingSpans" << endl;
+    return;                                    // возвращаем обещанное функцией значение
+}
+
+#else
+
+// собрана ли программа с трассировкой
+bool traceEnabled()
+{
+    return false;
+}
+
+
+
+// без SOBEL_TRACE отрезков нет
+void traceReset()
+{
+    return;                                    // возвращаем обещанное функцией значение
+}
+
+
+
+bool traceWriteChrome(const string&)
+{
+    return false;
+}
+
+
+
+void tracePrintSummary(ostream& out)
+{
+    out << "Трассировка выключена: соберите с -DSOBEL_TRACE=ON" << endl;
+    return;                                    // возвращаем обещанное функцией значение
+}
+
+#endif // SOBEL_TRACE
@@ -0,0 +1,75 @@
+#ifndef STAGE_TRACE_H
+#define STAGE_TRACE_H
+
+#include <ostream>                  // заголовочный файл потока вывода для сводной таблицы
+#include <string>                   // заголовочный файл строк путей
+
+
+
+/**************************************************************************/
+/*   Г Л О Б А Л Ь Н Ы Е    К О Н С Т А Н Т Ы   И   П Е Р Е М Е Н Н Ы Е   */
+/**************************************************************************/
+
+const int traceRingSpans = 1 << 16; // отрезков в кольцевом буфере одного потока - старые затираются новыми
+
+
+
+/**************************************************************************/
+/*                       Т И П Ы   Д А Н Н Ы Х                            */
+/**************************************************************************/
+
+// трассировка этапов обработки. Каждый поток пишет отрезки времени своих этапов в собственный кольцевой
+// буфер без блокировок; буферы читаются только после завершения работы (после ThreadPool::wait или
+// присоединения потоков). Без SOBEL_TRACE макросы раскрываются в ничто и не стоят ни такта
+#ifdef SOBEL_TRACE
+
+// отрезок времени этапа: имя запоминается при создании, время окончания - при выходе из области видимости
+class TraceSpanScope
+{
+public:
+    explicit TraceSpanScope(const char* name);
+    ~TraceSpanScope();
+
+private:
+    TraceSpanScope(const TraceSpanScope&);        // отрезок не копируется
+    TraceSpanScope& operator=(const TraceSpanScope&);
+
+    const char* name;                // имя этапа - строковый литерал, хранится только указатель
+    unsigned long long begin;        // время начала в наносекундах монотонных часов
+};// TraceSpanScope
+
+// имя потока в трассировке
+void traceThreadName(const char* name);
+
+#define SOBEL_TRACE_CONCAT_(a, b) a##b
+#define SOBEL_TRACE_CONCAT(a, b) SOBEL_TRACE_CONCAT_(a, b)
+#define SOBEL_TRACE_SPAN(name) TraceSpanScope SOBEL_TRACE_CONCAT(traceSpan, __LINE__)(name)
+#define SOBEL_TRACE_THREAD_NAME(name) traceThreadName(name)
+
+#else
+
+#define SOBEL_TRACE_SPAN(name) ((void)0)
+#define SOBEL_TRACE_THREAD_NAME(name) ((void)0)
+
+#endif // SOBEL_TRACE
+
+
+
+/**************************************************************************/
+/*                 П Р О Т О Т И П Ы   Ф У Н К Ц И Й                      */
+/**************************************************************************/
+
+// собрана ли программа с трассировкой
+bool traceEnabled();
+
+// удаление всех записанных отрезков. Вызывается, когда ни один поток не обрабатывает кадр
+void traceReset();
+
+// запись отрезков всех потоков в формате Chrome trace event (chrome://tracing, Perfetto)
+bool traceWriteChrome(const std::string& path); // путь до JSON-файла
+
+// сводная таблица по этапам: количество отрезков, суммарное, среднее и наибольшее время и дисбаланс -
+// отношение наибольшей суммы одного потока к средней по потокам этапа
+void tracePrintSummary(std::ostream& out);     // поток вывода
+
+#endif // STAGE_TRACE_H
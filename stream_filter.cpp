@@ -0,0 +1,288 @@
+#include "stream_filter.h"          // заголовочный файл потоковой обработки больших изображений
+#include "mapped_image.h"           // заголовочный файл изображения, отображённого в память
+#include "sobel_filter.h"           // заголовочный файл многопоточного фильтра Собеля
+#include "stage_trace.h"            // заголовочный файл трассировки этапов
+#include <cstring>                  // заголовочный файл для memcpy и memset
+#include <cfloat>                   // заголовочный файл для DBL_MAX
+#include <algorithm>                // заголовочный файл для min и max
+#include <vector>                   // заголовочный файл динамических массивов задач и ореолов
+#include <unistd.h>                 // заголовочный файл для unlink
+
+using namespace std;                // используем пространство имён std
+using namespace cv;                 // используем пространство имён cv
+
+
+
+/**************************************************************************/
+/*                       Т И П Ы   Д А Н Н Ы Х                            */
+/**************************************************************************/
+
+// проходы потоковой обработки, которые раздаются порциями через планировщик
+enum StreamPass
+{
+    PASS_SOBEL,                     // яркость и магнитуда
+    PASS_NORMALIZE,                 // нормализация и гистограмма
+    PASS_COUNT                      // количество проходов с планировщиком
+};// StreamPass
+
+// общие данные всех задач потоковой обработки
+struct StreamContext
+{
+    const MappedImage* input;       // входной файл
+    MappedImage* output;            // выходной файл: сначала магнитуда, затем нормализованная магнитуда, затем результат
+    SobelKernelIsa isa;             // набор инструкций слитого ядра
+    int numWorkers;                 // количество задач
+    int stripRows;                  // строк в одной полосе
+    RowScheduler* chunks;           // планировщики полос, по одному на проход StreamPass
+    BandStats* stats;               // частичные результаты всех задач
+    pthread_barrier_t* barrier;     // барьер между проходами
+};// StreamContext
+
+// данные одной задачи
+struct StreamTask
+{
+    StreamContext* context;         // общие данные
+    int worker;                     // номер задачи
+    ScratchArena* arena;            // арена временной памяти для полос
+    vector<uchar> topHalo;          // выровненные строки над областью задачи, снятые до записи результата
+    vector<uchar> bottomHalo;       // выровненные строки под областью задачи
+    vector<uchar> carry;            // выровненные последние строки предыдущей полосы - их место уже занял результат
+};// StreamTask
+
+
+
+/*------------------------------------------------------------------------*/
+/*                Функции               */
+/*--------------------------------------*/
+
+// ожидание остальных задач на барьере между проходами
+static inline void streamBarrierWait(pthread_barrier_t* barrier)
+{
+    SOBEL_TRACE_SPAN("barrier");
+    pthread_barrier_wait(barrier);
+}
+
+
+
+// канал яркости строк [startRow, endRow] входного файла в lumaWindow
+static void stripLuma(const MappedImage& input, int startRow, int endRow, Mat& lumaWindow, ScratchArena& arena)
+{
+    int windowRows = endRow - startRow + 1;    // строк в окне
+    Mat inputWindow(windowRows, input.cols(), CV_8UC(input.channels()), input.row(startRow), input.step());
+
+    // PPM хранит каналы в порядке RGB - переводим в YUV с учётом этого порядка, а не переставляем каналы
+    if (input.rgb())
+    {
+        Mat yuvWindow(windowRows, input.cols(), CV_8UC3, arena.allocate(windowRows * input.cols() * 3));
+        cvtColor(inputWindow, yuvWindow, COLOR_RGB2YUV);
+        extractChannel(yuvWindow, lumaWindow, 0);
+    }// if
+    else
+        lumaWithRange(inputWindow, lumaWindow, 0, windowRows - 1, arena);
+    return;                                    // возвращаем обещанное функцией значение
+}
+
+
+
+// точка входа задачи потоковой обработки
+static void* streamThread(void* taskPointer)
+{
+    StreamTask* task = static_cast<StreamTask*>(taskPointer);
+    StreamContext& context = *task->context;
+    const MappedImage& input = *context.input;
+    MappedImage& output = *context.output;
+    ScratchArena& arena = *task->arena;
+    BandStats& own = context.stats[task->worker];
+    int rows = input.rows(), cols = input.cols();
+    int startRow, endRow;                      // строки очередной полосы
+
+    // заголовок на весь выходной файл - память не выделяется, страницы подгружаются по мере обращения
+    Mat outputImage(rows, cols, CV_8UC1, output.row(0), output.step());
+
+    own.minValue = DBL_MAX;
+    own.maxValue = -DBL_MAX;
+    memset(own.histogram, 0, sizeof(own.histogram));
+
+    // первый проход: яркость полосы с ореолом в одну строку и магнитуда слитым ядром прямо в выходной файл
+    {
+        SOBEL_TRACE_SPAN("stream_sobel");
+        while (context.chunks[PASS_SOBEL].next(task->worker, startRow, endRow))
+        {
+            arena.reset();                     // временные данные прошлой полосы больше не нужны
+            int top = max(0, startRow - 1), bottom = min(rows - 1, endRow + 1);
+            Mat lumaWindow(bottom - top + 1, cols, CV_8UC1, arena.allocate((bottom - top + 1) * cols));
+            stripLuma(input, top, bottom, lumaWindow, arena);
+
+            // на краях кадра окно кончается там же, где кадр, поэтому отражение на краю то же, что у целого кадра
+            sobelFusedWithRange(lumaWindow.ptr(), lumaWindow.step, lumaWindow.rows, cols, startRow - top, endRow - top,
+                                output.row(startRow), output.step(), fusedMagnitudeScale, context.isa);
+
+            double minValue, maxValue;         // минимум и максимум магнитуды полосы
+            minMaxLoc(outputImage.rowRange(startRow, endRow + 1), &minValue, &maxValue);
+            own.minValue = min(own.minValue, minValue);
+            own.maxValue = max(own.maxValue, maxValue);
+
+            // прочитанные и записанные строки выгружаются - в памяти остаются только текущие полосы
+            input.release(startRow, endRow);
+            output.release(startRow, endRow);
+        }// while
+    }
+    streamBarrierWait(context.barrier);
+
+    // свёртка минимума и максимума в одинаковом порядке у всех задач
+    double minValue = DBL_MAX, maxValue = -DBL_MAX;
+    for (int i = 0; i < context.numWorkers; i++)
+    {
+        minValue = min(minValue, context.stats[i].minValue);
+        maxValue = max(maxValue, context.stats[i].maxValue);
+    }// for i
+
+    // второй проход: нормализация на месте по минимуму и максимуму всего кадра и гистограмма своих полос
+    {
+        SOBEL_TRACE_SPAN("stream_normalize");
+        while (context.chunks[PASS_NORMALIZE].next(task->worker, startRow, endRow))
+        {
+            normalizeWithRange(outputImage, outputImage, minValue, maxValue, startRow, endRow, own.histogram);
+            output.release(startRow, endRow);
+        }// while
+    }
+    streamBarrierWait(context.barrier);
+
+    // свёртка гистограмм и таблица выравнивания всего кадра
+    long long histogram[256] = {0};            // гистограмма всего кадра: пикселей в скане может быть больше 2^31
+    uchar lut[256];                            // таблица выравнивания
+    for (int i = 0; i < context.numWorkers; i++)
+        for (int bin = 0; bin < 256; bin++)
+            histogram[bin] += context.stats[i].histogram[bin];
+    equalizeLut(histogram, lut);
+
+    // третий проход пишет результат на место нормализованной магнитуды, а размытию нужны выровненные строки
+    // соседей. Поэтому каждая задача берёт непрерывную область кадра и проходит её полосами сверху вниз,
+    // а строки-ореолы над и под областью снимает до барьера, пока их не перезаписали соседние задачи
+    int radius = unsharpRadius;                // радиус размытия - высота ореола
+    int regionStart = (int)((long long)task->worker * rows / context.numWorkers);
+    int regionEnd = (int)((long long)(task->worker + 1) * rows / context.numWorkers) - 1;
+    int haloTop = max(0, regionStart - radius), haloBottom = min(rows - 1, regionEnd + radius);
+
+    if (regionStart <= regionEnd)
+    {
+        task->topHalo.resize((size_t)(regionStart - haloTop) * cols);
+        task->bottomHalo.resize((size_t)(haloBottom - regionEnd) * cols);
+        task->carry.resize((size_t)radius * cols);
+
+        for (int y = haloTop; y < regionStart; y++)
+            for (int x = 0; x < cols; x++)
+                task->topHalo[(size_t)(y - haloTop) * cols + x] = lut[output.row(y)[x]];
+        for (int y = regionEnd + 1; y <= haloBottom; y++)
+            for (int x = 0; x < cols; x++)
+                task->bottomHalo[(size_t)(y - regionEnd - 1) * cols + x] = lut[output.row(y)[x]];
+    }// if
+    streamBarrierWait(context.barrier);
+
+    {
+        SOBEL_TRACE_SPAN("stream_unsharp");
+        for (startRow = regionStart; startRow <= regionEnd; startRow += context.stripRows)
+        {
+            arena.reset();                     // временные данные прошлой полосы больше не нужны
+            endRow = min(regionEnd, startRow + context.stripRows - 1);
+            int top = max(0, startRow - radius), bottom = min(rows - 1, endRow + radius);
+
+            // окно выровненных строк полосы с ореолами: над областью и под ней - снятые ореолы,
+            // выше полосы внутри области - перенос из прошлой полосы, остальное - выравнивание строк файла
+            Mat window(bottom - top + 1, cols, CV_8UC1, arena.allocate((bottom - top + 1) * cols));
+            for (int y = top; y <= bottom; y++)
+            {
+                uchar* dst = window.ptr(y - top);
+                if (y < regionStart)
+                    memcpy(dst, &task->topHalo[(size_t)(y - haloTop) * cols], cols);
+                else if (y > regionEnd)
+                    memcpy(dst, &task->bottomHalo[(size_t)(y - regionEnd - 1) * cols], cols);
+                else if (y < startRow)
+                    memcpy(dst, &task->carry[(size_t)(y % radius) * cols], cols);
+                else
+                {
+                    const uchar* src = output.row(y);
+                    for (int x = 0; x < cols; x++)
+                        dst[x] = lut[src[x]];
+                }// else
+            }// for y
+
+            // последние строки полосы понадобятся следующей полосе как ореол, а в файле их место займёт результат
+            for (int y = max(startRow, endRow - radius + 1); y <= endRow; y++)
+                memcpy(&task->carry[(size_t)(y % radius) * cols], window.ptr(y - top), cols);
+
+            // окно кончается на краю кадра там же, где кадр, поэтому отражение то же, что у целого кадра
+            Mat outputWindow(bottom - top + 1, cols, CV_8UC1, output.row(top), output.step());
+            unsharpWithRange(window, outputWindow, startRow - top, endRow - top, arena);
+            output.release(startRow, endRow);
+        }// for startRow
+    }
+
+    return NULL;                               // задача выполнена
+}
+
+
+
+// функция потоковой обработки изображения, которое не помещается в память
+int runStream(const string& inputPath,         // входной файл PGM, PPM или сырых пикселей
+              const string& outputPath,        // выходной файл
+              const string& rawFormat,         // размер сырого входа WxHxC
+              int numThreads,                  // количество рабочих потоков
+              int stripRows,                   // строк в одной полосе
+              bool pinThreads)                 // закреплять ли рабочие потоки за ядрами
+{
+    numThreads = max(1, numThreads);
+    stripRows = max(1, stripRows);
+
+    MappedImage input, output;                 // входной и выходной файлы
+    if (!input.open(inputPath, rawFormat))
+        return -2;                             // входной файл не открылся или формат не поддерживается
+
+    // создание выхода обрезает файл, а вход ещё отображён: чтение обрезанного входа закончилось бы SIGBUS
+    if (input.sameFile(outputPath))
+        return -6;                             // выходной файл совпадает со входным
+    if (!output.create(outputPath, input.rows(), input.cols()))
+        return -5;                             // выходной файл не создан
+
+    ThreadPool pool;                           // рабочие потоки
+    if (pool.start(numThreads, pinThreads) != 0)
+    {
+        // результата не будет - пустой выходной файл полного размера не оставляем
+        output.close();
+        unlink(outputPath.c_str());
+        return -3;                             // поток создан некорректно
+    }// if
+
+    RowScheduler chunks[PASS_COUNT];           // планировщики полос первых двух проходов
+    vector<BandStats> stats(numThreads);       // частичные результаты задач
+    vector<ScratchArena> arenas(numThreads);   // арены временной памяти задач
+    vector<StreamTask> tasks(numThreads);      // данные задач
+    pthread_barrier_t barrier;                 // барьер между проходами
+    pthread_barrier_init(&barrier, NULL, numThreads);
+
+    StreamContext context;                     // общие данные задач
+    context.input = &input;
+    context.output = &output;
+    context.isa = sobelDetectIsa();
+    context.numWorkers = numThreads;
+    context.stripRows = stripRows;
+    context.chunks = chunks;
+    context.stats = &stats[0];
+    context.barrier = &barrier;
+    for (int pass = 0; pass < PASS_COUNT; pass++)
+        chunks[pass].reset(input.rows(), stripRows, numThreads, true);
+
+    // задач ровно столько, сколько потоков в пуле: все они ждут друг друга на барьере
+    for (int i = 0; i < numThreads; i++)
+    {
+        tasks[i].context = &context;
+        tasks[i].worker = i;
+        tasks[i].arena = &arenas[i];
+        pool.submit(streamThread, &tasks[i]);
+    }// for i
+
+    pool.wait();
+    pool.stop();
+    pthread_barrier_destroy(&barrier);
+    return 0;                                  // изображение обработано
+}
@@ -0,0 +1,36 @@
+#ifndef STREAM_FILTER_H
+#define STREAM_FILTER_H
+
+#include <string>                   // заголовочный файл строк путей
+
+
+
+/**************************************************************************/
+/*   Г Л О Б А Л Ь Н Ы Е    К О Н С Т А Н Т Ы   И   П Е Р Е М Е Н Н Ы Е   */
+/**************************************************************************/
+
+const int defaultStripRows = 64;    // строк в одной полосе потоковой обработки, если не задано аргументом strip=N
+
+
+
+/**************************************************************************/
+/*                 П Р О Т О Т И П Ы   Ф У Н К Ц И Й                      */
+/**************************************************************************/
+
+// функция потоковой обработки изображения, которое не помещается в память. Вход (PGM, PPM или сырые пиксели)
+// и выход отображаются в память через mmap, и кадр проходит полосами по stripRows строк с ореолами:
+// 1) яркость и магнитуда слитым ядром сразу в выходной файл, минимум и максимум полос;
+// 2) нормализация по всему кадру на месте в выходном файле и гистограмма;
+// 3) выравнивание по общей таблице и повышение резкости с записью результата на место магнитуды.
+// Каждый поток держит в памяти лишь несколько полос, а обработанные строки выгружаются, поэтому занятая
+// память не зависит от размера изображения. Результат побитово совпадает с SobelProcessor со слитым ядром.
+// Возвращает 0 или отрицательный код ошибки: -2 - вход не открылся, -5 - выход не создан,
+// -6 - выход совпадает со входом, -3 - не созданы рабочие потоки
+int runStream(const std::string& inputPath,    // входной файл PGM, PPM или сырых пикселей
+              const std::string& outputPath,   // выходной файл: PGM, если оканчивается на .pgm, иначе сырые пиксели
+              const std::string& rawFormat,    // размер сырого входа WxHxC, пусто для PGM и PPM
+              int numThreads,                  // количество рабочих потоков
+              int stripRows,                   // строк в одной полосе
+              bool pinThreads);                // закреплять ли рабочие потоки за ядрами
+
+#endif // STREAM_FILTER_H
@@ -0,0 +1,161 @@
+#include "thread_pool.h"            // заголовочный файл пула рабочих потоков
+#include <unistd.h>                 // заголовочный файл для sysconf - количества ядер процессора
+#ifdef __linux__
+#include <sched.h>                  // заголовочный файл для cpu_set_t - закрепления потока за ядром
+#endif
+
+
+
+/*------------------------------------------------------------------------*/
+/*                Функции               */
+/*--------------------------------------*/
+
+ThreadPool::ThreadPool()
+    : pending(0), stopping(false)
+{
+    pthread_mutex_init(&mutex, NULL);
+    pthread_cond_init(&jobReady, NULL);
+    pthread_cond_init(&jobsDone, NULL);
+}
+
+
+
+ThreadPool::~ThreadPool()
+{
+    stop();                                    // присоединяем потоки до уничтожения мьютекса и условных переменных
+    pthread_cond_destroy(&jobsDone);
+    pthread_cond_destroy(&jobReady);
+    pthread_mutex_destroy(&mutex);
+}
+
+
+
+// создание numWorkers рабочих потоков с необязательным закреплением за ядрами
+int ThreadPool::start(int numWorkers, bool pinToCores)
+{
+    long numCores = sysconf(_SC_NPROCESSORS_ONLN); // количество доступных ядер для закрепления потоков
+
+    stopping = false;
+    workers.reserve(numWorkers);
+
+    // проходим по всем потокам, которые нам надо создать
+    for (int i = 0; i < numWorkers; ++i)
+    {
+        pthread_t thread;                      // очередной рабочий поток
+
+        // создание потока и запуск в нём цикла ожидания задач
+        int res = pthread_create(&thread, NULL, workerMain, this);
+
+        // ошибка создания потока: останавливаем уже созданные и возвращаем код ошибки
+        if (res != 0)
+        {
+            stop();
+            return res;
+        }// if
+        workers.push_back(thread);
+
+#ifdef __linux__
+        // закрепление потока за ядром, чтобы планировщик не переносил его между ядрами вместе с кэшем
+        if (pinToCores && numCores > 0)
+        {
+            cpu_set_t cpus;
+            CPU_ZERO(&cpus);
+            CPU_SET(i % numCores, &cpus);
+            pthread_setaffinity_np(thread, sizeof(cpus), &cpus);
+        }// if
+#else
+        (void)pinToCores;
+        (void)numCores;
+#endif
+    }// for i
+
+    return 0;                                  // все потоки созданы
+}
+
+
+
+// остановка пула с присоединением рабочих потоков
+void ThreadPool::stop()
+{
+    // поднимаем флаг остановки и будим все ожидающие потоки
+    pthread_mutex_lock(&mutex);
+    stopping = true;
+    pthread_cond_broadcast(&jobReady);
+    pthread_mutex_unlock(&mutex);
+
+    // ожидание завершения всех рабочих потоков
+    for (size_t i = 0; i < workers.size(); ++i)
+        pthread_join(workers[i], NULL);
+    workers.clear();
+    return;                                    // возвращаем обещанное функцией значение
+}
+
+
+
+// количество рабочих потоков
+int ThreadPool::size() const
+{
+    return (int)workers.size();
+}
+
+
+
+// постановка задачи в очередь
+void ThreadPool::submit(void* (*routine)(void*), void* arg)
+{
+    ThreadPoolJob job;                         // новая задача
+    job.routine = routine;
+    job.arg = arg;
+
+    pthread_mutex_lock(&mutex);
+    jobs.push_back(job);
+    pending++;
+    pthread_cond_signal(&jobReady);            // будим один из ожидающих рабочих потоков
+    pthread_mutex_unlock(&mutex);
+    return;                                    // возвращаем обещанное функцией значение
+}
+
+
+
+// ожидание выполнения всех поставленных задач
+void ThreadPool::wait()
+{
+    pthread_mutex_lock(&mutex);
+    while (pending > 0)
+        pthread_cond_wait(&jobsDone, &mutex);
+    pthread_mutex_unlock(&mutex);
+    return;                                    // возвращаем обещанное функцией значение
+}
+
+
+
+// точка входа рабочего потока: берёт задачи из очереди, пока пул не остановлен
+void* ThreadPool::workerMain(void* poolPointer)
+{
+    ThreadPool* pool = static_cast<ThreadPool*>(poolPointer);
+
+    pthread_mutex_lock(&pool->mutex);
+    for (;;)
+    {
+        // ждём задачу; при остановке пула сначала доделываем оставшуюся очередь
+        while (pool->jobs.empty() && !pool->stopping)
+            pthread_cond_wait(&pool->jobReady, &pool->mutex);
+        if (pool->jobs.empty())
+            break;
+
+        ThreadPoolJob job = pool->jobs.front();
+        pool->jobs.pop_front();
+
+        // задача выполняется без мьютекса, чтобы остальные потоки могли брать свои задачи
+        pthread_mutex_unlock(&pool->mutex);
+        job.routine(job.arg);
+        pthread_mutex_lock(&pool->mutex);
+
+        // последняя выполненная задача будит основной поток
+        if (--pool->pending == 0)
+            pthread_cond_broadcast(&pool->jobsDone);
+    }// for
+    pthread_mutex_unlock(&pool->mutex);
+
+    return NULL;                               // рабочий поток завершён
+}
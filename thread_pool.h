@@ -0,0 +1,62 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <pthread.h>                // заголовочный файл, предназначенный для работы с потоками в многопоточном программировании
+#include <deque>                    // заголовочный файл очереди задач
+#include <vector>                   // заголовочный файл динамического массива потоков
+
+
+
+/**************************************************************************/
+/*                       Т И П Ы   Д А Н Н Ы Х                            */
+/**************************************************************************/
+
+// задача для пула: та же точка входа, что и у pthread_create, и её аргумент
+struct ThreadPoolJob
+{
+    void* (*routine)(void*);        // функция, выполняемая рабочим потоком
+    void* arg;                      // данные, передаваемые функции
+};// ThreadPoolJob
+
+// пул рабочих потоков pthread: потоки создаются один раз и переиспользуются между кадрами и запусками.
+// Задачи передаются через очередь под мьютексом, рабочие потоки ждут их на условной переменной,
+// а основной поток ждёт окончания всех задач на второй условной переменной
+class ThreadPool
+{
+public:
+    ThreadPool();
+    ~ThreadPool();                  // останавливает и присоединяет рабочие потоки, если они ещё работают
+
+    // создание numWorkers рабочих потоков. При pinToCores поток i закрепляется за ядром i по модулю числа ядер.
+    // Возвращает 0 при успехе или код ошибки pthread_create
+    int start(int numWorkers, bool pinToCores);
+
+    // остановка: рабочие потоки доделывают очередь и завершаются, основной поток присоединяет их
+    void stop();
+
+    // количество рабочих потоков
+    int size() const;
+
+    // постановка задачи в очередь
+    void submit(void* (*routine)(void*), void* arg);
+
+    // ожидание выполнения всех поставленных задач
+    void wait();
+
+private:
+    // точка входа рабочего потока: берёт задачи из очереди, пока пул не остановлен
+    static void* workerMain(void* pool);
+
+    ThreadPool(const ThreadPool&);            // пул не копируется: потоки держат указатель на него
+    ThreadPool& operator=(const ThreadPool&);
+
+    std::vector<pthread_t> workers;           // рабочие потоки
+    std::deque<ThreadPoolJob> jobs;           // очередь задач
+    pthread_mutex_t mutex;                    // мьютекс, защищающий очередь и счётчики
+    pthread_cond_t jobReady;                  // сигнал рабочим потокам: появилась задача или пул остановлен
+    pthread_cond_t jobsDone;                  // сигнал основному потоку: все задачи выполнены
+    int pending;                              // количество поставленных, но ещё не выполненных задач
+    bool stopping;                            // флаг остановки пула
+};// ThreadPool
+
+#endif // THREAD_POOL_H